@@ -24,6 +24,7 @@ public:
 	void setDomain(int64_t, int64_t);
 	
 	int64_t getCurr() const override;
+	void setCurr(int64_t);
 	bool next() override;
 	void reset() override;
 };
@@ -35,7 +36,7 @@ DiscreteFeature::DiscreteFeature(std::string n)
 {}
 DiscreteFeature::DiscreteFeature(std::string n, int64_t min, int64_t max)
 	: name(n)
-    , curr(0)
+    , curr(min) // same start as after reset
     , domain(Domain<int64_t>(min, max))
 {}
 DiscreteFeature::DiscreteFeature(const DiscreteFeature& f)
@@ -63,6 +64,10 @@ void DiscreteFeature::reset() {
 int64_t DiscreteFeature::getCurr() const {
 	return this->curr;
 }
+void DiscreteFeature::setCurr(int64_t c) {
+	assert(c >= this->domain.getMin() && c <= this->domain.getMax());
+	this->curr = c;
+}
 bool DiscreteFeature::next() {
 	bool canNext = !(this->curr == this->domain.getMax());
 	if (canNext)
@@ -2,11 +2,14 @@
 
 #include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <stdio.h>
 
 #include "DynamicBitSet.hpp"
+#include "RandomGenerator.hpp"
 
 /*
     pack onlyOneBitRaised-constrained Features into an int (make expandable wtih multiple ints for large groups).
@@ -17,21 +20,40 @@
 */
 
 class OnlyOneHighBConstrainedFeatureSet {
-    DynamicBitSet<uint8_t> nonRandomBools;
-    DynamicBitSet<uint8_t> randomBools; // 2 of these? one for non randoms one for randoms?
-    std::mt19937* gen;
-    std::vector<uint32_t> nonRandomIndexes;
+    // the raised member is tracked directly, as a slot in nonRandomIndexes (counting members) or in randomIndexes.
+    // a raised counting member wins over the random one. per member tables turn index lookups into array reads
+    constexpr static uint32_t NONE = -1;
+    Random::Generator* gen;
+    std::vector<uint32_t> nonRandomIndexes; // set positions of the counting features, in next() order
+    std::vector<uint32_t> randomIndexes; // set positions of the random features, in ascending order
+    std::vector<uint32_t> nonRandomSlot; // per set position, its slot in nonRandomIndexes or NONE
+    uint32_t highNonRandom; // slot in nonRandomIndexes or NONE
+    uint32_t highRandom; // slot in randomIndexes or NONE
+    DynamicBitSet<uint64_t> curr; // the raised feature as a bit per set position, follows the two slots
+
+    auto updateCurr() -> void;
 public:
     OnlyOneHighBConstrainedFeatureSet(
         const std::vector<uint32_t>&,
         const std::vector<std::string>&
     );
     OnlyOneHighBConstrainedFeatureSet() = delete;
-    auto setGenerator(std::mt19937*) -> void;
+    auto setGenerator(Random::Generator*) -> void;
     auto setRandoms() -> void;
     auto clearRandoms() -> void;
+    auto size() const -> uint32_t;
     auto getCurr() const -> std::vector<double>;
+    auto writeCurr(float*) const -> void;
     auto getAtIndex(uint32_t) const -> double;
+    auto getHighIndex() const -> uint32_t;
+    auto getRandomCount() const -> uint32_t;
+    auto getChoiceCount() const -> uint32_t;
+    auto isHighFixed() const -> bool;
+    auto sampleHighIndexes(uint32_t*, size_t, size_t) const -> void;
+    auto highIndexesFromUniform(const float*, uint32_t*, size_t, size_t) const -> void;
+    auto getStateCount() const -> uint32_t;
+    auto getState() const -> uint32_t;
+    auto setState(uint32_t) -> void;
     auto next() -> bool;
     auto reset() -> void;
 };
@@ -39,93 +61,141 @@ public:
 OnlyOneHighBConstrainedFeatureSet::OnlyOneHighBConstrainedFeatureSet(
     const std::vector<uint32_t>& nRandomIndexes,
     const std::vector<std::string>& allFeatures
-) {
-    uint32_t nonRandomsLen = nRandomIndexes.size();
-    uint32_t featuresLen = allFeatures.size();
-    this->nonRandomIndexes = std::vector<uint32_t>(nRandomIndexes);
-    this->nonRandomBools = DynamicBitSet<uint8_t>(nonRandomsLen);
-    this->randomBools = DynamicBitSet<uint8_t>(featuresLen - nonRandomsLen);
-    //std::cout << "nonRandomSize: " << this->nonRandomBools.size() << " randomSize: " << this->randomBools.size()
-    //    << " m1 " << nonRandomsLen << " m2 " << (featuresLen - nonRandomsLen) << std::endl;
-    if (this->randomBools.size() == 0) // if there are no randoms, then the start step where all non randoms are zero is invalid
+)
+    : gen(nullptr)
+    , nonRandomIndexes(nRandomIndexes)
+    , highNonRandom(NONE)
+    , highRandom(NONE)
+{
+    const uint32_t featuresLen = allFeatures.size();
+    this->nonRandomSlot = std::vector<uint32_t>(featuresLen, NONE);
+    for (uint32_t slot = 0; slot < this->nonRandomIndexes.size(); slot++)
+        this->nonRandomSlot[this->nonRandomIndexes[slot]] = slot;
+    this->randomIndexes = std::vector<uint32_t>();
+    for (uint32_t i = 0; i < featuresLen; i++)
+        if (this->nonRandomSlot[i] == NONE)
+            this->randomIndexes.push_back(i);
+    this->curr = DynamicBitSet<uint64_t>(featuresLen);
+    if (this->randomIndexes.size() == 0) // if there are no randoms, then the start step where all non randoms are zero is invalid
         this->next();
 }
-auto OnlyOneHighBConstrainedFeatureSet::setGenerator(std::mt19937* g) -> void {
+auto OnlyOneHighBConstrainedFeatureSet::setGenerator(Random::Generator* g) -> void {
     this->gen = g;
 }
 auto OnlyOneHighBConstrainedFeatureSet::setRandoms() -> void { // useful when non randoms are all not set
-    //std::cout << "setting randoms 0" << std::endl;
-    if (this->randomBools.size() == 0) return; // if empty, nothign to do
-    if (this->nonRandomBools.popcount() != 0) {
+    if (this->randomIndexes.size() == 0) return; // if empty, nothign to do
+    if (this->highNonRandom != NONE) {
         this->clearRandoms();
         return; // if nonrandoms are set, then randoms must be zero
     }
-    //std::cout << "setting randoms 1" << std::endl;
-    uint32_t size = this->randomBools.size();
-    auto dist = std::uniform_int_distribution<uint32_t>(0, size - 1);
-    uint32_t rand = dist(*this->gen);
-    this->randomBools.clear();
-    //std::cout << "setting randoms 2 size: " << this->randomBools.size() << std::endl;
-    this->randomBools.set(rand, true);
-    //std::cout << "setting randoms done" << std::endl;
+    this->highRandom = this->gen->uniformIndex(this->randomIndexes.size());
+    this->updateCurr();
 }
 auto OnlyOneHighBConstrainedFeatureSet::clearRandoms() -> void {
-    this->randomBools.clear();
+    this->highRandom = NONE;
+    this->updateCurr();
+}
+auto OnlyOneHighBConstrainedFeatureSet::updateCurr() -> void {
+    this->curr.clear();
+    const uint32_t high = this->getHighIndex();
+    if (high != NONE)
+        this->curr.setUnchecked(high, true);
+}
+auto OnlyOneHighBConstrainedFeatureSet::size() const -> uint32_t {
+    return this->nonRandomSlot.size();
 }
 auto OnlyOneHighBConstrainedFeatureSet::getCurr() const -> std::vector<double> {
-    auto ret = std::vector<double>();
-    const auto totalLen = this->nonRandomBools.size() + this->randomBools.size();
-    ret.reserve(totalLen);
-    auto randomsIndexOffset = 0;
-    for (auto i = 0; i < totalLen; i++) {
-        uint32_t found = 0;
-        for (auto j = 0; j < this->nonRandomIndexes.size(); j++)
-            if (this->nonRandomIndexes[j] == i) {
-                found = j + 1; // add one cause zeroth index is falsey
-                break;
-            }
-        if (found) { // check if truely, ie not zero
-            ret.push_back(this->nonRandomBools.get(found - 1));
-            randomsIndexOffset++; // indirect that gets the correct index in randomBools when subtracted from i
-        }
-        else
-            ret.push_back(this->randomBools.get(i - randomsIndexOffset));
-    }
+    auto ret = std::vector<double>(this->size(), 0.0);
+    this->curr.forEachSet([&ret](uint32_t i) { ret[i] = 1.0; });
     return ret;
 }
+auto OnlyOneHighBConstrainedFeatureSet::writeCurr(float* out) const -> void { // size() floats, expanded from the bits
+    this->curr.expandTo(out);
+}
 auto OnlyOneHighBConstrainedFeatureSet::getAtIndex(uint32_t index) const -> double {
-    const auto totalLen = this->nonRandomBools.size() + this->randomBools.size();
-    if (index >= totalLen)
+    if (index >= this->size())
         throw std::out_of_range("Index is out of range on contraint. index: "
-            + std::to_string(index) + " totalLen: " + std::to_string(totalLen)
+            + std::to_string(index) + " totalLen: " + std::to_string(this->size())
         );
-    uint32_t s = 0;
-    for (auto i = 0; i < this->nonRandomIndexes.size(); i++) {
-        if (this->nonRandomIndexes[i] == index) return this->nonRandomBools[i];
-        if (this->nonRandomIndexes[i] < index) s++; // number of nonRandoms which are offsetting index
-    }
-    return this->randomBools[index - s]; // index - s = index if non rnadoms were gone
+    return this->curr.getUnchecked(index);
 }
-auto OnlyOneHighBConstrainedFeatureSet::next() -> bool {
-    const auto len = this->nonRandomBools.size();
-    if (len == 0) return false;
-    if (this->nonRandomBools.popcount() == 0 && len > 0) { // case all zero
-        this->nonRandomBools.set(0, true);
-        return true;
+auto OnlyOneHighBConstrainedFeatureSet::getHighIndex() const -> uint32_t { // index of the raised feature, -1 if none
+    if (this->highNonRandom != NONE) return this->nonRandomIndexes[this->highNonRandom];
+    if (this->highRandom != NONE) return this->randomIndexes[this->highRandom];
+    return NONE;
+}
+auto OnlyOneHighBConstrainedFeatureSet::getRandomCount() const -> uint32_t {
+    return this->randomIndexes.size();
+}
+auto OnlyOneHighBConstrainedFeatureSet::getChoiceCount() const -> uint32_t {
+    // distinct high indexes sampleHighIndexes can give at the current counting state
+    if (this->isHighFixed()) return 1;
+    return this->randomIndexes.size();
+}
+auto OnlyOneHighBConstrainedFeatureSet::isHighFixed() const -> bool { // the counting state alone decides the raised feature
+    return this->randomIndexes.size() == 0 || this->highNonRandom != NONE;
+}
+auto OnlyOneHighBConstrainedFeatureSet::sampleHighIndexes(uint32_t* out, size_t count, size_t stride) const -> void {
+    // what getHighIndex would return after each of count setRandoms calls, stride apart. state is left alone
+    if (this->isHighFixed()) { // high feature is fixed
+        const uint32_t high = this->getHighIndex();
+        for (size_t i = 0; i < count; i++)
+            out[i * stride] = high;
+        return;
     }
-    uint32_t i = 0;
-    while (i < len) { // case one set
-        if (this->nonRandomBools[i])
-            break;
-        i++;
+    this->gen->fillUniformIndex(out, count, stride, this->randomIndexes.size());
+    for (size_t i = 0; i < count; i++)
+        out[i * stride] = this->randomIndexes[out[i * stride]];
+}
+auto OnlyOneHighBConstrainedFeatureSet::highIndexesFromUniform(const float* u, uint32_t* out, size_t count, size_t stride) const -> void {
+    // sampleHighIndexes with the choice of random feature taken from u in [0, 1)
+    if (this->isHighFixed()) {
+        const uint32_t high = this->getHighIndex();
+        for (size_t i = 0; i < count; i++)
+            out[i * stride] = high;
+        return;
     }
-    // i is either == len (ie none found (shouldn't be possible)) or an index of the set value
-    if (i == len) throw std::out_of_range("next on constrained set i == len: " + std::to_string(len));
-    if (i == len - 1) return false; // can't next cause we're at the end
-    this->nonRandomBools.set(i, false);
-    this->nonRandomBools.set(i + 1, true);
+    const uint32_t size = this->randomIndexes.size();
+    for (size_t i = 0; i < count; i++)
+        out[i * stride] = this->randomIndexes[std::min<uint32_t>((uint32_t) (u[i] * size), size - 1)];
+}
+auto OnlyOneHighBConstrainedFeatureSet::getStateCount() const -> uint32_t {
+    // states next() walks through from reset: all counting members low (only when a random member can be high
+    // instead), then each counting member raised in turn
+    const uint32_t len = this->nonRandomIndexes.size();
+    if (len == 0) return 1;
+    return this->randomIndexes.size() == 0 ? len : len + 1;
+}
+auto OnlyOneHighBConstrainedFeatureSet::getState() const -> uint32_t { // position in that walk
+    if (this->randomIndexes.size() == 0) return this->highNonRandom == NONE ? 0 : this->highNonRandom;
+    return this->highNonRandom == NONE ? 0 : this->highNonRandom + 1;
+}
+auto OnlyOneHighBConstrainedFeatureSet::setState(uint32_t state) -> void {
+    if (state >= this->getStateCount())
+        throw std::out_of_range("State " + std::to_string(state) + " of constrained set with "
+            + std::to_string(this->getStateCount()) + " states");
+    if (this->nonRandomIndexes.size() == 0) return;
+    if (this->randomIndexes.size() == 0)
+        this->highNonRandom = state;
+    else
+        this->highNonRandom = state == 0 ? NONE : state - 1;
+    this->updateCurr();
+}
+auto OnlyOneHighBConstrainedFeatureSet::next() -> bool { // all low, then each counting member raised in turn
+    const uint32_t len = this->nonRandomIndexes.size();
+    if (len == 0) return false;
+    if (this->highNonRandom == NONE) // case all zero
+        this->highNonRandom = 0;
+    else if (this->highNonRandom == len - 1)
+        return false; // can't next cause we're at the end
+    else
+        this->highNonRandom++;
+    this->updateCurr();
     return true;
 }
 auto OnlyOneHighBConstrainedFeatureSet::reset() -> void {
-    this->nonRandomBools.clear();
+    this->highNonRandom = this->randomIndexes.size() == 0 && this->nonRandomIndexes.size() != 0
+        ? 0 // nothing else could be high, all low isn't a valid state
+        : NONE;
+    this->updateCurr();
 }
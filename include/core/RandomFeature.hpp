@@ -3,22 +3,28 @@
 #include <assert.h>
 #include <string>
 #include <memory>
-#include <random>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 #include "RandomFeatureBase.hpp"
 #include "HasCurr.hpp"
 #include "Domain.hpp"
 #include "Numeric.hpp"
 #include "Integral.hpp"
+#include "EmpiricalDistribution.hpp"
 
 template <Concepts::Numeric N>
 class RandomFeature : public RandomFeatureBase, HasCurr<N> {
 	std::string name;
 	N curr;
 	Domain<N> domain;
-	std::mt19937* gen;
+	Random::Generator* gen;
+	std::shared_ptr<const Random::EmpiricalDistribution> distribution; // null samples the domain uniformly
 
-	using DistType = std::conditional<Concepts::Integral<N>, std::uniform_int_distribution<N>, std::uniform_real_distribution<N>>::type;
+	double binWidth() const;
+	N fromBin(uint32_t, double) const;
+	double binWeight(uint32_t) const;
 public:
 	RandomFeature(std::string);
 	RandomFeature(std::string, N, N);
@@ -27,11 +33,16 @@ public:
 
 	N getCurr() const override;
 	bool next() override;
+	void sample(float*, size_t, size_t, float* = nullptr) const;
+	void fromUniform(const float*, float*, size_t, size_t, float* = nullptr) const;
 
 	std::string getName() const override;
 	void setName(std::string) override;
 	void setDomain(N, N);
-	void setGenerator(std::mt19937*);
+	Domain<N> getDomain() const;
+	void setGenerator(Random::Generator*);
+	void setDistribution(std::shared_ptr<const Random::EmpiricalDistribution>);
+	bool hasDistribution() const;
 };
 template <Concepts::Numeric N>
 RandomFeature<N>::RandomFeature(std::string n)
@@ -47,7 +58,7 @@ RandomFeature<N>::RandomFeature(std::string n, N min, N max)
 }
 template <Concepts::Numeric N>
 RandomFeature<N>::RandomFeature(const RandomFeature<N>& f)
-	: name(f.getName()), gen(f.gen), domain(f.domain)
+	: name(f.getName()), gen(f.gen), domain(f.domain), distribution(f.distribution)
 {}
 template <Concepts::Numeric N>
 N RandomFeature<N>::getCurr() const {
@@ -56,11 +67,81 @@ N RandomFeature<N>::getCurr() const {
 template <Concepts::Numeric N>
 bool RandomFeature<N>::next() {
 	if (this->gen == nullptr) return false;
-	auto dist = RandomFeature<N>::DistType(this->domain.getMin(), this->domain.getMax());
-	this->curr = dist(*this->gen);
+	if (this->distribution) {
+		const uint64_t bits = (*this->gen)();
+		this->curr = this->fromBin(this->distribution->pick((uint32_t) (bits >> 32)), (uint32_t) bits * 0x1.0p-32);
+		return true;
+	}
+	if constexpr (Concepts::Integral<N>)
+		this->curr = this->gen->uniformInt(this->domain.getMin(), this->domain.getMax());
+	else
+		this->curr = this->gen->uniformReal(this->domain.getMin(), this->domain.getMax());
 	return true;
 }
 template <Concepts::Numeric N>
+void RandomFeature<N>::sample(float* out, size_t count, size_t stride, float* weights) const {
+	// count draws, stride floats apart. curr is left alone. weights, if given, is multiplied by each draw's
+	// importance weight back to the uniform domain, see binWeight
+	if (this->gen == nullptr) return;
+	if (this->distribution) { // high 32 bits choose the bin, low 32 place the draw inside it
+		for (size_t i = 0; i < count; i++) {
+			const uint64_t bits = (*this->gen)();
+			const uint32_t bin = this->distribution->pick((uint32_t) (bits >> 32));
+			out[i * stride] = (float) this->fromBin(bin, (uint32_t) bits * 0x1.0p-32);
+			if (weights != nullptr)
+				weights[i] *= (float) this->binWeight(bin);
+		}
+		return;
+	}
+	if constexpr (Concepts::Integral<N>)
+		this->gen->fillUniformInt(out, count, stride, this->domain.getMin(), this->domain.getMax());
+	else
+		this->gen->fillUniformReal(out, count, stride, this->domain.getMin(), this->domain.getMax());
+}
+template <Concepts::Numeric N>
+void RandomFeature<N>::fromUniform(const float* u, float* out, size_t count, size_t stride, float* weights) const {
+	// u in [0, 1) -> domain, weights as in sample
+	const double min = this->domain.getMin();
+	const double max = this->domain.getMax();
+	if (this->distribution) { // inverse cdf
+		double within;
+		for (size_t i = 0; i < count; i++) {
+			const uint32_t bin = this->distribution->fromUniform(u[i], within);
+			out[i * stride] = (float) this->fromBin(bin, within);
+			if (weights != nullptr)
+				weights[i] *= (float) this->binWeight(bin);
+		}
+		return;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if constexpr (Concepts::Integral<N>) // equal width bins, one per integer
+			out[i * stride] = (float) std::min<double>(min + std::floor(u[i] * (max - min + 1.0)), max);
+		else
+			out[i * stride] = (float) (min + u[i] * (max - min));
+	}
+}
+template <Concepts::Numeric N>
+double RandomFeature<N>::binWidth() const { // integral domains have one bin per value
+	if constexpr (Concepts::Integral<N>)
+		return 1.0;
+	else
+		return ((double) this->domain.getMax() - this->domain.getMin()) / this->distribution->getBins();
+}
+template <Concepts::Numeric N>
+N RandomFeature<N>::fromBin(uint32_t bin, double within) const { // within in [0, 1) places continuous values inside the bin
+	if constexpr (Concepts::Integral<N>)
+		return this->domain.getMin() + (N) bin;
+	else
+		return std::min<N>(this->domain.getMin() + (bin + within) * this->binWidth(), this->domain.getMax());
+}
+template <Concepts::Numeric N>
+double RandomFeature<N>::binWeight(uint32_t bin) const {
+	// uniform density over the empirical density in a drawn bin, which turns averages over draws from the
+	// distribution back into averages over the uniform domain. taken from the bin drawn, not recovered from the
+	// rounded value, which can land in a neighbouring bin (or an empty one) at an edge. a drawn bin has p > 0
+	return 1.0 / (this->distribution->getBins() * this->distribution->getProbability(bin));
+}
+template <Concepts::Numeric N>
 std::string RandomFeature<N>::getName() const {
 	return this->name;
 }
@@ -73,6 +154,23 @@ void RandomFeature<N>::setDomain(N min, N max) {
 	this->domain.setMinAndMax(min, max);
 }
 template <Concepts::Numeric N>
-void RandomFeature<N>::setGenerator(std::mt19937* gen) {
+Domain<N> RandomFeature<N>::getDomain() const {
+	return this->domain;
+}
+template <Concepts::Numeric N>
+void RandomFeature<N>::setGenerator(Random::Generator* gen) {
 	this->gen = gen;
 }
+template <Concepts::Numeric N>
+void RandomFeature<N>::setDistribution(std::shared_ptr<const Random::EmpiricalDistribution> d) {
+	if constexpr (Concepts::Integral<N>) {
+		if (d && (uint64_t) (this->domain.getMax() - this->domain.getMin()) + 1 != d->getBins())
+			throw std::invalid_argument("histogram of " + this->name + " needs one bin per value of its domain ("
+				+ std::to_string(this->domain.getMax() - this->domain.getMin() + 1) + "), got " + std::to_string(d->getBins()));
+	}
+	this->distribution = d;
+}
+template <Concepts::Numeric N>
+bool RandomFeature<N>::hasDistribution() const {
+	return this->distribution != nullptr;
+}
@@ -1,12 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <unordered_map>
 #include <variant>
 #include <string>
 #include <memory>
 #include <type_traits>
-#include <functional>
 
 #include <stdio.h>
 
@@ -19,6 +19,9 @@
 //#include "RandomDiscreteFeature.hpp"
 #include "RandomFeature.hpp"
 #include "OnlyOneHighBConstrainedFeatureSet.hpp"
+#include "EmpiricalDistribution.hpp"
+#include "RandomGenerator.hpp"
+#include "QuasiRandom.hpp"
 
 
 // helper constant for visitors
@@ -46,7 +49,12 @@ concept ContainerTypes = std::is_same_v<NonRandomVariant, C> || std::is_same_v<R
 
 using CurrVariantType = std::variant<double, int64_t>;
 
-using GetCurrFunctionType = std::function<bool (CurrVariantType&)>;
+enum class GatherSource : uint8_t { NONE, CONTINUOUS, DISCRETE, RANDOM_CONTINUOUS, RANDOM_DISCRETE, CONSTRAINED };
+struct GatherStep { // where one model input's value is read from
+    GatherSource source;
+    uint32_t slot; // index into nonRandoms, randoms or constrainedFeatures
+    uint32_t member; // position within the constrained set
+};
 
 class TrialManager {
     std::vector<NonRandomVariant> nonRandoms;
@@ -54,7 +62,31 @@ class TrialManager {
     std::vector<RandomVariant> randoms;
     std::vector<std::string> featureNamesInOrder;
     std::vector<uint32_t> nonRandomIndexes;
-    std::unordered_map<std::string, GetCurrFunctionType> getCurrMap;
+    std::vector<std::vector<uint32_t>> constrainedIndexes; // model input positions of each constrained set's features
+    std::vector<GatherStep> gatherPlan; // one step per model input, in model order
+    Random::Generator* gen;
+    SAMPLING_MODE samplingMode;
+    // sampling modes other than MONTE_CARLO draw a uniform column per random dimension (randoms, then constrained
+    // sets) and map it onto the feature
+    constexpr static uint32_t CONTINUOUS_STRATA = 64; // strata of a continuous dimension in STRATIFIED mode
+    Random::ScrambledHalton halton;
+    std::vector<std::vector<uint32_t>> strataOrder; // STRATIFIED: current shuffled cycle, LATIN_HYPERCUBE: the point's permutation
+    std::vector<uint32_t> strataPosition; // STRATIFIED: next entry of strataOrder
+    uint64_t plannedSamples; // samples the point is expected to take
+    uint64_t pointSample; // samples generated since beginPoint
+    std::vector<float> uniforms; // one column of uniform points
+    // when every random dimension is discrete and their combinations fit in the point's budget, sample i is the i-th
+    // combination in mixed radix instead (every combination is equally likely, so a plain mean is exact)
+    bool enumerationAllowed;
+    bool enumerating;
+    uint64_t enumerationSize;
+    std::vector<uint64_t> enumerationRadix; // values per random dimension
+    std::vector<uint64_t> enumerationStride; // product of the radices before it
+    // common random numbers: one sample matrix is drawn for the task and moved between counting points by
+    // refreshSamples. constrained sets with a counting member keep their draws, their high index follows the point
+    bool commonRandom;
+    std::vector<uint32_t> countingGroups;
+    std::vector<std::vector<float>> groupDraws; // per constrained set, one uniform per sample
     // with the above 2 combines, indexMap becomes simpler.
         // rands generally larger, so keep rands in order amongst themselves to output order
         // keep non rnads in order amongst themsevles
@@ -85,6 +117,10 @@ class TrialManager {
     template <ContainerTypes C>
     static auto getNames(const std::vector<C>&, std::vector<std::string>&) -> void;
     auto findIndexOrder(const std::string&) const -> uint32_t;
+    auto gather(const GatherStep&) const -> double;
+    auto uniformColumn(uint32_t, size_t, float*) -> void;
+    auto shuffle(std::vector<uint32_t>&) -> void;
+    auto writeOneHot(uint32_t, float*, size_t, uint32_t*) const -> void;
 public:
     TrialManager(
         const std::vector<std::string>&,
@@ -94,13 +130,34 @@ public:
     );
     TrialManager(const TrialManager&) = delete;
     auto setContinuousN(uint64_t) -> void;
-    auto setRandomGen(std::mt19937*) -> void;
+    auto setRandomGen(Random::Generator*) -> void;
+    auto setDistributions(const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>&) -> void;
     auto iterateCountingFeatures() -> bool;
+    auto gridSize() const -> uint64_t;
+    auto getGridIndex() const -> uint64_t;
+    auto seekGrid(uint64_t) -> void;
+    auto isOnCoarseGrid() const -> bool;
+    auto getCoarseGridIndex() const -> uint64_t;
+    auto getContinuousGridPlaces() const -> std::vector<uint64_t>;
     auto iterateRandomFeatures() -> void;
+    auto setSamplingMode(SAMPLING_MODE) -> void;
+    auto setEnumeration(bool) -> void;
+    auto beginPoint(uint64_t) -> uint64_t;
+    auto isEnumerating() const -> bool;
+    auto generateSamples(float*, size_t, uint32_t*, float* = nullptr) -> void;
+    auto setCommonRandomNumbers(bool) -> void;
+    auto refreshSamples(float*, size_t, size_t, uint32_t*) const -> void;
     auto getFeatureNames() const -> std::vector<std::string>;
+    auto getFeatureCount() const -> size_t;
     auto getCountingFeatureNames() const -> std::vector<std::string>;
+    auto getCountingIndexes() const -> const std::vector<uint32_t>&;
+    auto getOneHotColumns() const -> const std::vector<std::vector<uint32_t>>&;
+    auto getOneHotActive(uint32_t*) const -> void;
     auto getCurrent() const -> std::vector<CurrVariantType>;
+    auto getCurrent(float*) const -> void;
     auto getCountingCurrent() const -> std::vector<CurrVariantType>;
+    auto getCountingCurrent(float*) const -> void;
+    auto getCountingCurrent(double*) const -> void;
     ~TrialManager() = default;
 };
 
@@ -115,6 +172,14 @@ TrialManager::TrialManager(
     this->randoms = std::vector<RandomVariant>();
     this->featureNamesInOrder = std::vector<std::string>(predictionOrderFeatureNames);
     this->nonRandomIndexes = std::vector<uint32_t>();
+    this->gen = nullptr;
+    this->samplingMode = SAMPLING_MODE::MONTE_CARLO;
+    this->plannedSamples = 0;
+    this->pointSample = 0;
+    this->enumerationAllowed = true;
+    this->enumerating = false;
+    this->enumerationSize = 0;
+    this->commonRandom = false;
 
     for (const auto& nonRandom : nonRandomFeatures) {
         uint32_t index = -1;
@@ -128,16 +193,7 @@ TrialManager::TrialManager(
         this->nonRandomIndexes.push_back(index);
     }
 
-    GetCurrFunctionType tempLambda = [](CurrVariantType& out) -> bool {
-        std::cout << "TEMP handler getCurr being called! THIS IS AN ERROR!" << std::endl;
-        out = 0;
-        return false; // used as default. will always return false, signallying something went wrong.
-    };
-    this->getCurrMap = std::unordered_map<std::string, GetCurrFunctionType>();
-    
-    for (const auto& featName : this->featureNamesInOrder) {
-        this->getCurrMap[featName] = tempLambda;
-    }
+    this->gatherPlan = std::vector<GatherStep>(this->featureNamesInOrder.size(), GatherStep{GatherSource::NONE, 0, 0});
     std::vector<std::string> handled = std::vector<std::string>();
     
     if (constrainedFeatures.find(CONSTRAINT_TYPE::ONLYONEHIGHBINARY) != constrainedFeatures.end()) { // if has any constrained features
@@ -166,17 +222,18 @@ TrialManager::TrialManager(
             std::cout << std::endl;*/
             auto constrained = OnlyOneHighBConstrainedFeatureSet(nonRandomConstrIndexes, constrainedSet);
             this->constrainedFeatures.push_back(constrained);
-            for (auto i = 0; i < constrainedSet.size(); i++) { // add to handled and setup getCurrMap
+            auto columns = std::vector<uint32_t>();
+            for (const auto& featName : constrainedSet) {
+                const uint32_t column = this->findIndexOrder(featName);
+                if (column == (uint32_t) -1) throw std::invalid_argument("Constrained feature name not found in feature list.");
+                columns.push_back(column);
+            }
+            this->constrainedIndexes.push_back(columns);
+            for (auto i = 0; i < constrainedSet.size(); i++) { // add to handled and setup gatherPlan
                 const auto featName = constrainedSet[i];
                 handled.push_back(featName);
                 //std::cout << "handling (constr): " << featName << std::endl;
-                this->getCurrMap[featName] = [this, constrainedSetIndex, i](CurrVariantType& out) -> bool {
-                    //std::cout << "onlyOne Handler getCurr being called!" << std::endl;
-                    //auto temp = this->constrainedFeatures[constrainedSetIndex].getAtIndex(i);
-                    //std::cout << "\t onlyOneHandler: val was " << temp << std::endl;
-                    out = this->constrainedFeatures[constrainedSetIndex].getAtIndex(i);
-                    return true;
-                };
+                this->gatherPlan[columns[i]] = GatherStep{GatherSource::CONSTRAINED, (uint32_t) constrainedSetIndex, (uint32_t) i};
             }
         } // constrained should all be made correctly
     }
@@ -189,13 +246,16 @@ TrialManager::TrialManager(
         auto domainVariant = featuresAndDomains.at(nonRandom);
         std::visit([&](auto&& arg) {
             using T = std::decay_t<decltype(arg)>;
+            const uint32_t slot = this->nonRandoms.size();
             if constexpr (std::is_same_v<T, Domain<double>>) {
                 auto domain = std::get<Domain<double>>(domainVariant);
                 wentWell &= this->addFeature<ContinuousFeature>(nonRandom, domain, this->nonRandoms);
+                this->gatherPlan[this->findIndexOrder(nonRandom)] = GatherStep{GatherSource::CONTINUOUS, slot, 0};
             }
             else if constexpr (std::is_same_v<T, Domain<int64_t>>) {
                 auto domain = std::get<Domain<int64_t>>(domainVariant);
                 wentWell &= this->addFeature<DiscreteFeature>(nonRandom, domain, this->nonRandoms);
+                this->gatherPlan[this->findIndexOrder(nonRandom)] = GatherStep{GatherSource::DISCRETE, slot, 0};
             }
             else
                 static_assert(always_false_v<T>, "Constructor (NonRandoms): non-exhaustive visitor!");
@@ -204,16 +264,6 @@ TrialManager::TrialManager(
             std::cout << "Failed adding feature to nonRandoms "
                 << "featureName: " << nonRandom << std::endl;
         }
-        uint32_t indexOfFeature = this->nonRandoms.size() - 1;
-        this->getCurrMap[nonRandom] = [this, indexOfFeature](CurrVariantType& out) -> bool {
-            //std::cout << "non random handler getCurr being called!" << std::endl;
-            std::visit([&](auto&& arg) {
-                //auto temp = arg.getCurr();
-                //std::cout << "\t nonRandomHandler: val was " << temp << std::endl;
-                out = arg.getCurr();
-            }, this->nonRandoms[indexOfFeature]);
-            return true;
-        };
         //std::cout << "handling (norand): " << nonRandom << std::endl;
         handled.push_back(nonRandom);
     } // nonRandomsShould all be done
@@ -223,13 +273,16 @@ TrialManager::TrialManager(
         auto domainVariant = featuresAndDomains.at(featName);
         std::visit([&](auto&& arg) {
             using T = std::decay_t<decltype(arg)>;
+            const uint32_t slot = this->randoms.size();
             if constexpr (std::is_same_v<T, Domain<double>>) {
                 auto domain = std::get<Domain<double>>(domainVariant);
                 wentWell &= this->addFeature<RandomFeature<double>>(featName, domain, this->randoms);
+                this->gatherPlan[this->findIndexOrder(featName)] = GatherStep{GatherSource::RANDOM_CONTINUOUS, slot, 0};
             }
             else if constexpr (std::is_same_v<T, Domain<int64_t>>) {
                 auto domain = std::get<Domain<int64_t>>(domainVariant);
                 wentWell &= this->addFeature<RandomFeature<int64_t>>(featName, domain, this->randoms);
+                this->gatherPlan[this->findIndexOrder(featName)] = GatherStep{GatherSource::RANDOM_DISCRETE, slot, 0};
             }
             else
                 static_assert(always_false_v<T>, "Constructor (Randoms): non-exhaustive visitor!");
@@ -238,25 +291,18 @@ TrialManager::TrialManager(
             std::cout << "Failed adding feature to randoms "
                 << "featureName: " << featName << std::endl;
         }
-        uint32_t indexOfFeature = this->randoms.size() - 1;
-        this->getCurrMap[featName] = [this, indexOfFeature](CurrVariantType& out) -> bool {
-            //std::cout << "random handler getCurr being called!" << std::endl;
-            std::visit([&](auto&& arg) {
-                out = arg.getCurr();
-                //auto temp = arg.getCurr();
-                //std::cout << "\t randomHandler: val was " << temp << std::endl;
-            }, this->randoms[indexOfFeature]);
-            return true;
-        };
         //std::cout << "handling (random): " << featName << std::endl;
         handled.push_back(featName);
     }
     assert(handled.size() == this->featureNamesInOrder.size());
+    for (const auto& step : this->gatherPlan)
+        if (step.source == GatherSource::NONE)
+            throw std::invalid_argument("Feature in feature list has no source in the gather plan.");
     //std::cout << "total unconstrained features" << this->randoms.size() + this->nonRandoms.size() << std::endl;
     //std::cout << "construction complete" << std::endl;
     
 
-    // after creating all constructs, can setup curr getter functions
+    // after creating all constructs, gatherPlan maps every model input to its owner
 
     // std::cout << "algorithm order:\n"
     //     << '\t';
@@ -303,7 +349,8 @@ auto TrialManager::setContinuousN(uint64_t n) -> void {
         }, f);
     }
 }
-auto TrialManager::setRandomGen(std::mt19937* gen) -> void {
+auto TrialManager::setRandomGen(Random::Generator* gen) -> void {
+    this->gen = gen;
     for (auto& f : this->randoms) {
         std::visit([&](auto&& arg) {
             //using T = std::decay_t<decltype(arg)>;
@@ -318,6 +365,16 @@ auto TrialManager::setRandomGen(std::mt19937* gen) -> void {
         c.setGenerator(gen);
     }
 }
+auto TrialManager::setDistributions(
+    const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>& distributions
+) -> void { // random features named in distributions are drawn from them, the rest stay uniform
+    for (auto& f : this->randoms)
+        std::visit([&](auto&& arg) {
+            const auto found = distributions.find(arg.getName());
+            if (found != distributions.end())
+                arg.setDistribution(found->second);
+        }, f);
+}
 auto TrialManager::iterateCountingFeatures() -> bool {
     bool notAbleToNext = true;
     const auto len = this->nonRandoms.size();
@@ -341,6 +398,112 @@ auto TrialManager::iterateCountingFeatures() -> bool {
     }
     return notAbleToNext;
 }
+auto TrialManager::gridSize() const -> uint64_t {
+    // counting points iterateCountingFeatures walks before it reports done. the walk is an odometer, so point i
+    // is i in mixed radix: nonRandoms in order (fastest first), then the constrained sets
+    uint64_t size = 1;
+    for (const auto& f : this->nonRandoms)
+        std::visit([&](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, ContinuousFeature>)
+                size *= arg.getDenominator() + 1; // numerator 0..denominator
+            else
+                size *= (uint64_t) (arg.getDomain().getMax() - arg.getDomain().getMin()) + 1;
+        }, f);
+    for (const auto& constrained : this->constrainedFeatures)
+        size *= constrained.getStateCount();
+    return size;
+}
+auto TrialManager::getGridIndex() const -> uint64_t { // index of the current counting point, for resuming
+    uint64_t index = 0;
+    uint64_t place = 1;
+    for (const auto& f : this->nonRandoms)
+        std::visit([&](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, ContinuousFeature>) {
+                index += arg.getNumerator() * place;
+                place *= arg.getDenominator() + 1;
+            }
+            else {
+                index += (uint64_t) (arg.getCurr() - arg.getDomain().getMin()) * place;
+                place *= (uint64_t) (arg.getDomain().getMax() - arg.getDomain().getMin()) + 1;
+            }
+        }, f);
+    for (const auto& constrained : this->constrainedFeatures) {
+        index += constrained.getState() * place;
+        place *= constrained.getStateCount();
+    }
+    return index;
+}
+auto TrialManager::seekGrid(uint64_t index) -> void {
+    // moves the counting features to point index of the walk, as if iterateCountingFeatures had been called index
+    // times from the start. any range of a pair's grid can then run on its own
+    if (index >= this->gridSize())
+        throw std::out_of_range("Grid index " + std::to_string(index) + " past grid size " + std::to_string(this->gridSize()));
+    for (auto& f : this->nonRandoms)
+        std::visit([&](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, ContinuousFeature>) {
+                const uint64_t radix = arg.getDenominator() + 1;
+                arg.setNumerator(index % radix);
+                index /= radix;
+            }
+            else {
+                const uint64_t radix = (uint64_t) (arg.getDomain().getMax() - arg.getDomain().getMin()) + 1;
+                arg.setCurr(arg.getDomain().getMin() + (int64_t) (index % radix));
+                index /= radix;
+            }
+        }, f);
+    for (auto& constrained : this->constrainedFeatures) {
+        const uint32_t radix = constrained.getStateCount();
+        constrained.setState(index % radix);
+        index /= radix;
+    }
+}
+auto TrialManager::isOnCoarseGrid() const -> bool { // current point is also a point of the grid at n - 1
+    for (const auto& f : this->nonRandoms)
+        if (const auto* continuous = std::get_if<ContinuousFeature>(&f); continuous && continuous->getNumerator() % 2 != 0)
+            return false;
+    return true;
+}
+auto TrialManager::getCoarseGridIndex() const -> uint64_t {
+    // getGridIndex the current point would have at n - 1, halving every numerator. only for isOnCoarseGrid points
+    uint64_t index = 0;
+    uint64_t place = 1;
+    for (const auto& f : this->nonRandoms)
+        std::visit([&](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, ContinuousFeature>) {
+                index += arg.getNumerator() / 2 * place;
+                place *= arg.getDenominator() / 2 + 1;
+            }
+            else {
+                index += (uint64_t) (arg.getCurr() - arg.getDomain().getMin()) * place;
+                place *= (uint64_t) (arg.getDomain().getMax() - arg.getDomain().getMin()) + 1;
+            }
+        }, f);
+    for (const auto& constrained : this->constrainedFeatures) {
+        index += constrained.getState() * place;
+        place *= constrained.getStateCount();
+    }
+    return index;
+}
+auto TrialManager::getContinuousGridPlaces() const -> std::vector<uint64_t> {
+    // grid index step of +1 numerator, per continuous counting feature. cells of the grid are built from these
+    auto places = std::vector<uint64_t>();
+    uint64_t place = 1;
+    for (const auto& f : this->nonRandoms)
+        std::visit([&](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, ContinuousFeature>) {
+                places.push_back(place);
+                place *= arg.getDenominator() + 1;
+            }
+            else
+                place *= (uint64_t) (arg.getDomain().getMax() - arg.getDomain().getMin()) + 1;
+        }, f);
+    return places;
+}
 auto TrialManager::iterateRandomFeatures() -> void {
     for (auto& r : this->randoms)
         std::visit([&](auto&& arg) {
@@ -352,15 +515,287 @@ auto TrialManager::iterateRandomFeatures() -> void {
     }
     //std::cout << "done with iterating randoms" << std::endl;
 }
+auto TrialManager::setSamplingMode(SAMPLING_MODE mode) -> void {
+    this->samplingMode = mode;
+    const size_t dimensions = this->randoms.size() + this->constrainedFeatures.size();
+    if (mode == SAMPLING_MODE::QUASI_MONTE_CARLO)
+        this->halton = Random::ScrambledHalton(dimensions);
+    this->strataOrder = std::vector<std::vector<uint32_t>>(dimensions);
+    this->strataPosition = std::vector<uint32_t>(dimensions, 0);
+    if (mode == SAMPLING_MODE::STRATIFIED) { // one stratum per value for discrete dimensions and constrained sets
+        for (size_t d = 0; d < dimensions; d++) {
+            uint64_t strata = CONTINUOUS_STRATA;
+            if (d < this->randoms.size()) {
+                if (const auto* discrete = std::get_if<RandomFeature<int64_t>>(&this->randoms[d]))
+                    strata = (uint64_t) (discrete->getDomain().getMax() - discrete->getDomain().getMin()) + 1;
+            }
+            else
+                strata = this->constrainedFeatures[d - this->randoms.size()].getRandomCount();
+            strata = std::clamp<uint64_t>(strata, 1, 1 << 16); // very wide discrete domains fall back to coarser strata
+            this->strataOrder[d] = std::vector<uint32_t>(strata);
+            for (uint32_t k = 0; k < strata; k++)
+                this->strataOrder[d][k] = k;
+        }
+    }
+}
+auto TrialManager::setEnumeration(bool allowed) -> void {
+    this->enumerationAllowed = allowed;
+}
+auto TrialManager::beginPoint(uint64_t samples) -> uint64_t {
+    // call at each counting point, before its generateSamples calls. returns the samples the point should take:
+    // samples, or fewer when the random features can be enumerated exactly
+    this->pointSample = 0;
+    this->enumerating = false;
+    if (this->enumerationAllowed) {
+        const size_t dimensions = this->randoms.size() + this->constrainedFeatures.size();
+        if (this->enumerationRadix.size() != dimensions) {
+            this->enumerationRadix.resize(dimensions);
+            this->enumerationStride.resize(dimensions);
+        }
+        uint64_t size = 1;
+        for (size_t d = 0; d < dimensions && size <= samples; d++) {
+            uint64_t radix = samples + 1; // continuous features can't be enumerated
+            if (d >= this->randoms.size())
+                radix = this->constrainedFeatures[d - this->randoms.size()].getChoiceCount(); // depends on the counting state
+            else if (const auto* discrete = std::get_if<RandomFeature<int64_t>>(&this->randoms[d]); discrete && !discrete->hasDistribution())
+                radix = (uint64_t) (discrete->getDomain().getMax() - discrete->getDomain().getMin()) + 1; // combinations are equally likely
+            this->enumerationRadix[d] = radix;
+            this->enumerationStride[d] = size;
+            size = radix > samples ? samples + 1 : size * radix;
+        }
+        if (size <= samples) {
+            this->enumerating = true;
+            this->enumerationSize = size;
+            this->plannedSamples = size;
+            return size;
+        }
+    }
+    this->plannedSamples = samples;
+    if (this->gen == nullptr) return samples;
+    switch (this->samplingMode) { // fresh randomization per point keeps the point's estimate unbiased
+    case SAMPLING_MODE::QUASI_MONTE_CARLO:
+        this->halton.scramble(*this->gen);
+        break;
+    case SAMPLING_MODE::STRATIFIED:
+        for (size_t d = 0; d < this->strataOrder.size(); d++) {
+            auto& order = this->strataOrder[d];
+            for (uint32_t k = 0; k < order.size(); k++) // reshuffles start from the same order, so a point
+                order[k] = k;                           // doesn't depend on the points before it
+            this->strataPosition[d] = order.size(); // reshuffled on first use
+        }
+        break;
+    case SAMPLING_MODE::LATIN_HYPERCUBE:
+        for (auto& order : this->strataOrder) {
+            if (order.size() != samples)
+                order.resize(samples); // allocates only when the planned count changes
+            for (uint32_t k = 0; k < samples; k++)
+                order[k] = k;
+            this->shuffle(order);
+        }
+        break;
+    case SAMPLING_MODE::MONTE_CARLO:
+        break;
+    }
+    return samples;
+}
+auto TrialManager::isEnumerating() const -> bool {
+    return this->enumerating;
+}
+auto TrialManager::shuffle(std::vector<uint32_t>& order) -> void { // fisher-yates
+    for (size_t k = order.size(); k > 1; k--)
+        std::swap(order[k - 1], order[this->gen->uniformIndex(k)]);
+}
+auto TrialManager::uniformColumn(uint32_t dimension, size_t rows, float* out) -> void {
+    // the next rows points of one random dimension, in [0, 1)
+    constexpr const float belowOne = 0x1.fffffep-1f;
+    if (this->enumerating) { // middle of the digit's bin, so fromUniform lands exactly on the value
+        const uint64_t radix = this->enumerationRadix[dimension];
+        const uint64_t stride = this->enumerationStride[dimension];
+        for (size_t i = 0; i < rows; i++) {
+            const uint64_t combination = (this->pointSample + i) % this->enumerationSize;
+            out[i] = ((combination / stride) % radix + 0.5f) / radix;
+        }
+        return;
+    }
+    switch (this->samplingMode) {
+    case SAMPLING_MODE::QUASI_MONTE_CARLO:
+        this->halton.fill(dimension, this->pointSample, rows, out, 1);
+        return;
+    case SAMPLING_MODE::STRATIFIED: { // jittered within the stratum. whole cycles visit every stratum equally
+        auto& order = this->strataOrder[dimension];
+        auto& position = this->strataPosition[dimension];
+        const float strata = order.size();
+        this->gen->fillUniformReal(out, rows, 1, 0.0, 1.0);
+        for (size_t i = 0; i < rows; i++) {
+            if (position == order.size()) {
+                this->shuffle(order);
+                position = 0;
+            }
+            out[i] = std::min((order[position++] + out[i]) / strata, belowOne);
+        }
+        return;
+    }
+    case SAMPLING_MODE::LATIN_HYPERCUBE: { // sample i lands in slice order[i] of N
+        const auto& order = this->strataOrder[dimension];
+        const float slices = order.size();
+        this->gen->fillUniformReal(out, rows, 1, 0.0, 1.0);
+        for (size_t i = 0; i < rows; i++) {
+            const uint64_t sample = this->pointSample + i;
+            if (sample < order.size()) // past the planned count draws are plain uniform
+                out[i] = std::min((order[sample] + out[i]) / slices, belowOne);
+        }
+        return;
+    }
+    case SAMPLING_MODE::MONTE_CARLO:
+        this->gen->fillUniformReal(out, rows, 1, 0.0, 1.0);
+        return;
+    }
+}
+auto TrialManager::generateSamples(float* matrix, size_t rows, uint32_t* oneHotActive, float* weights) -> void {
+    // rows fresh samples at the current counting point, written row-major (getFeatureCount() floats per row) a column
+    // at a time. oneHotActive gets rows x constrained sets model columns, as getOneHotActive would give per sample.
+    // weights, if given, gets each row's importance weight back to the uniform domain (1 without distributions).
+    // outside MONTE_CARLO mode, or when enumerating, consecutive calls continue the point's design
+    const size_t width = this->gatherPlan.size();
+    const bool fromUniforms = this->enumerating || this->samplingMode != SAMPLING_MODE::MONTE_CARLO;
+    if ((fromUniforms || this->commonRandom) && this->uniforms.size() < rows)
+        this->uniforms.resize(rows); // grows once, to the batch size
+    if (weights != nullptr)
+        std::fill(weights, weights + rows, 1.0f);
+    for (size_t c = 0; c < width; c++) {
+        const auto& step = this->gatherPlan[c];
+        switch (step.source) {
+        case GatherSource::CONTINUOUS:
+        case GatherSource::DISCRETE: { // counting features hold still, broadcast down the column
+            const float value = (float) this->gather(step);
+            for (size_t r = 0; r < rows; r++)
+                matrix[r * width + c] = value;
+            break;
+        }
+        case GatherSource::RANDOM_CONTINUOUS: {
+            const auto* feature = std::get_if<RandomFeature<double>>(&this->randoms[step.slot]);
+            if (fromUniforms) {
+                this->uniformColumn(step.slot, rows, this->uniforms.data());
+                feature->fromUniform(this->uniforms.data(), matrix + c, rows, width, weights);
+            }
+            else
+                feature->sample(matrix + c, rows, width, weights);
+            break;
+        }
+        case GatherSource::RANDOM_DISCRETE: {
+            const auto* feature = std::get_if<RandomFeature<int64_t>>(&this->randoms[step.slot]);
+            if (fromUniforms) {
+                this->uniformColumn(step.slot, rows, this->uniforms.data());
+                feature->fromUniform(this->uniforms.data(), matrix + c, rows, width, weights);
+            }
+            else
+                feature->sample(matrix + c, rows, width, weights);
+            break;
+        }
+        case GatherSource::CONSTRAINED: // written per set below
+        case GatherSource::NONE:
+            break;
+        }
+    }
+    const size_t groups = this->constrainedFeatures.size();
+    for (size_t g = 0; g < groups; g++) {
+        if (fromUniforms || this->commonRandom) {
+            this->uniformColumn(this->randoms.size() + g, rows, this->uniforms.data());
+            if (this->commonRandom) {
+                auto& draws = this->groupDraws[g];
+                if (draws.size() < this->pointSample + rows)
+                    draws.resize(this->pointSample + rows);
+                std::copy(this->uniforms.begin(), this->uniforms.begin() + rows, draws.begin() + this->pointSample);
+            }
+            this->constrainedFeatures[g].highIndexesFromUniform(this->uniforms.data(), oneHotActive + g, rows, groups);
+        }
+        else
+            this->constrainedFeatures[g].sampleHighIndexes(oneHotActive + g, rows, groups);
+        this->writeOneHot(g, matrix, rows, oneHotActive);
+    }
+    this->pointSample += rows;
+}
+auto TrialManager::writeOneHot(uint32_t g, float* matrix, size_t rows, uint32_t* oneHotActive) const -> void {
+    // turns set g's position in oneHotActive into its model column and writes the set's columns to match
+    const size_t width = this->gatherPlan.size();
+    const size_t groups = this->constrainedFeatures.size();
+    const auto& columns = this->constrainedIndexes[g];
+    const auto& set = this->constrainedFeatures[g];
+    bool contiguous = !columns.empty();
+    for (size_t i = 1; i < columns.size() && contiguous; i++)
+        contiguous = columns[i] == columns[0] + i;
+    if (contiguous && set.isHighFixed()) { // every row takes the set's current state, expanded from its bits
+        for (size_t r = 0; r < rows; r++) {
+            set.writeCurr(matrix + r * width + columns[0]);
+            uint32_t& active = oneHotActive[r * groups + g];
+            if (active != (uint32_t) -1)
+                active = columns[active];
+        }
+        return;
+    }
+    for (size_t r = 0; r < rows; r++) {
+        float* row = matrix + r * width;
+        for (const auto& column : columns)
+            row[column] = 0.0f;
+        uint32_t& active = oneHotActive[r * groups + g];
+        if (active != (uint32_t) -1) {
+            active = columns[active];
+            row[active] = 1.0f;
+        }
+    }
+}
+auto TrialManager::setCommonRandomNumbers(bool common) -> void {
+    // when on, generateSamples keeps the constrained sets' draws so refreshSamples can reuse its samples at later
+    // counting points. turn enumeration off alongside, the enumerated size follows the counting state
+    this->commonRandom = common;
+    this->countingGroups = std::vector<uint32_t>();
+    this->groupDraws = std::vector<std::vector<float>>(this->constrainedFeatures.size());
+    for (uint32_t g = 0; g < this->constrainedIndexes.size(); g++)
+        for (const auto& column : this->constrainedIndexes[g])
+            if (std::find(this->nonRandomIndexes.begin(), this->nonRandomIndexes.end(), column) != this->nonRandomIndexes.end()) {
+                this->countingGroups.push_back(g);
+                break;
+            }
+}
+auto TrialManager::refreshSamples(float* matrix, size_t firstRow, size_t rows, uint32_t* oneHotActive) const -> void {
+    // moves rows firstRow.. of a matrix generateSamples made in common random numbers mode to the current counting
+    // point. matrix and oneHotActive point at those rows. random columns are left as drawn
+    const size_t width = this->gatherPlan.size();
+    const size_t groups = this->constrainedFeatures.size();
+    for (const auto& c : this->nonRandomIndexes) {
+        const float value = (float) this->gather(this->gatherPlan[c]);
+        for (size_t r = 0; r < rows; r++)
+            matrix[r * width + c] = value;
+    }
+    for (const auto& g : this->countingGroups) {
+        this->constrainedFeatures[g].highIndexesFromUniform(this->groupDraws[g].data() + firstRow, oneHotActive + g, rows, groups);
+        this->writeOneHot(g, matrix, rows, oneHotActive);
+    }
+}
 auto TrialManager::getFeatureNames() const -> std::vector<std::string>{
     return std::vector<std::string>(this->featureNamesInOrder);
 }
+auto TrialManager::getFeatureCount() const -> size_t {
+    return this->featureNamesInOrder.size();
+}
 auto TrialManager::getCountingFeatureNames() const -> std::vector<std::string> {
     auto names = std::vector<std::string>();
     for (auto i = 0; i < this->nonRandomIndexes.size(); i++)
         names.push_back(this->featureNamesInOrder[this->nonRandomIndexes[i]]);
     return names;
 }
+auto TrialManager::getCountingIndexes() const -> const std::vector<uint32_t>& {
+    return this->nonRandomIndexes; // model input positions, same order as getCountingFeatureNames
+}
+auto TrialManager::getOneHotColumns() const -> const std::vector<std::vector<uint32_t>>& {
+    return this->constrainedIndexes;
+}
+auto TrialManager::getOneHotActive(uint32_t* out) const -> void { // model input position of each constrained set's raised feature
+    for (size_t i = 0; i < this->constrainedFeatures.size(); i++) {
+        const uint32_t high = this->constrainedFeatures[i].getHighIndex();
+        out[i] = high == (uint32_t) -1 ? high : this->constrainedIndexes[i][high];
+    }
+}
 template <ContainerTypes C>
 auto TrialManager::getNames(const std::vector<C>& features, std::vector<std::string>& ret) -> void {
     ret.reserve(features.size());
@@ -372,20 +807,40 @@ auto TrialManager::getNames(const std::vector<C>& features, std::vector<std::str
         );
 }
 
+auto TrialManager::gather(const GatherStep& step) const -> double {
+    switch (step.source) { // alternatives are known from the plan, so no visit is needed
+    case GatherSource::CONTINUOUS:
+        return std::get_if<ContinuousFeature>(&this->nonRandoms[step.slot])->getCurr();
+    case GatherSource::DISCRETE:
+        return std::get_if<DiscreteFeature>(&this->nonRandoms[step.slot])->getCurr();
+    case GatherSource::RANDOM_CONTINUOUS:
+        return std::get_if<RandomFeature<double>>(&this->randoms[step.slot])->getCurr();
+    case GatherSource::RANDOM_DISCRETE:
+        return std::get_if<RandomFeature<int64_t>>(&this->randoms[step.slot])->getCurr();
+    case GatherSource::CONSTRAINED:
+        return this->constrainedFeatures[step.slot].getAtIndex(step.member);
+    case GatherSource::NONE:
+        break;
+    }
+    return 0; // unreachable, the constructor rejects plans with unset steps
+}
 auto TrialManager::getCurrent() const -> std::vector<CurrVariantType> {
-    //std::cout << "attemtping to get currents" << std::endl;
-    const size_t size = this->featureNamesInOrder.size();
     auto currents = std::vector<CurrVariantType>();
-    currents.reserve(size);
-    for (const auto& name : this->featureNamesInOrder) {
-        CurrVariantType building;
-        //std::cout << "calling " << name << "'s getcurr handler" << std::endl;
-        this->getCurrMap.at(name)(building);
-        //std::cout << "called getcurr func and got curr" << std::endl;
-        currents.push_back(building);
+    currents.reserve(this->gatherPlan.size());
+    for (const auto& step : this->gatherPlan) {
+        if (step.source == GatherSource::DISCRETE || step.source == GatherSource::RANDOM_DISCRETE)
+            currents.push_back((int64_t) this->gather(step));
+        else
+            currents.push_back(this->gather(step));
     }
     return currents;
 }
+auto TrialManager::getCurrent(float* out) const -> void { // writes getFeatureCount() values in model order, no allocation
+    const auto len = this->gatherPlan.size();
+    const GatherStep* plan = this->gatherPlan.data();
+    for (size_t i = 0; i < len; i++)
+        out[i] = (float) this->gather(plan[i]);
+}
 auto TrialManager::findIndexOrder(const std::string& s) const -> uint32_t {
     const auto len = this->featureNamesInOrder.size();
     for (auto i = 0; i < len; i++)
@@ -395,11 +850,21 @@ auto TrialManager::findIndexOrder(const std::string& s) const -> uint32_t {
 }
 auto TrialManager::getCountingCurrent() const -> std::vector<CurrVariantType> {
     auto currents = std::vector<CurrVariantType>();
-    auto names = this->getCountingFeatureNames();
-    for (const auto& name : names) {
-        CurrVariantType building;
-        this->getCurrMap.at(name)(building);
-        currents.push_back(building);
+    currents.reserve(this->nonRandomIndexes.size());
+    for (const auto& index : this->nonRandomIndexes) {
+        const auto& step = this->gatherPlan[index];
+        if (step.source == GatherSource::DISCRETE || step.source == GatherSource::RANDOM_DISCRETE)
+            currents.push_back((int64_t) this->gather(step));
+        else
+            currents.push_back(this->gather(step));
     }
     return currents;
 }
+auto TrialManager::getCountingCurrent(float* out) const -> void { // same order as getCountingIndexes
+    for (size_t i = 0; i < this->nonRandomIndexes.size(); i++)
+        out[i] = (float) this->gather(this->gatherPlan[this->nonRandomIndexes[i]]);
+}
+auto TrialManager::getCountingCurrent(double* out) const -> void { // full precision, for output coordinates
+    for (size_t i = 0; i < this->nonRandomIndexes.size(); i++)
+        out[i] = this->gather(this->gatherPlan[this->nonRandomIndexes[i]]);
+}
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <random>
+#include "RandomGenerator.hpp"
 
 struct HasGenerator {
-    virtual void setGenerator(std::mt19937*) = 0;
+    virtual void setGenerator(Random::Generator*) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "FrugallyDeepJson.hpp"
+
+namespace Inference {
+    namespace Simd { // widest float vector the build targets. build with -march=native to get avx2/avx-512
+    #if defined(__AVX512F__)
+        using Reg = __m512;
+        constexpr const size_t WIDTH = 16;
+        inline auto load(const float* p) -> Reg { return _mm512_loadu_ps(p); }
+        inline auto store(float* p, Reg v) -> void { _mm512_storeu_ps(p, v); }
+        inline auto broadcast(float f) -> Reg { return _mm512_set1_ps(f); }
+        inline auto fma(Reg a, Reg b, Reg c) -> Reg { return _mm512_fmadd_ps(a, b, c); }
+        inline auto add(Reg a, Reg b) -> Reg { return _mm512_add_ps(a, b); }
+        inline auto max(Reg a, Reg b) -> Reg { return _mm512_max_ps(a, b); }
+    #elif defined(__AVX2__) && defined(__FMA__)
+        using Reg = __m256;
+        constexpr const size_t WIDTH = 8;
+        inline auto load(const float* p) -> Reg { return _mm256_loadu_ps(p); }
+        inline auto store(float* p, Reg v) -> void { _mm256_storeu_ps(p, v); }
+        inline auto broadcast(float f) -> Reg { return _mm256_set1_ps(f); }
+        inline auto fma(Reg a, Reg b, Reg c) -> Reg { return _mm256_fmadd_ps(a, b, c); }
+        inline auto add(Reg a, Reg b) -> Reg { return _mm256_add_ps(a, b); }
+        inline auto max(Reg a, Reg b) -> Reg { return _mm256_max_ps(a, b); }
+    #elif defined(__SSE2__)
+        using Reg = __m128;
+        constexpr const size_t WIDTH = 4;
+        inline auto load(const float* p) -> Reg { return _mm_loadu_ps(p); }
+        inline auto store(float* p, Reg v) -> void { _mm_storeu_ps(p, v); }
+        inline auto broadcast(float f) -> Reg { return _mm_set1_ps(f); }
+        inline auto fma(Reg a, Reg b, Reg c) -> Reg { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        inline auto add(Reg a, Reg b) -> Reg { return _mm_add_ps(a, b); }
+        inline auto max(Reg a, Reg b) -> Reg { return _mm_max_ps(a, b); }
+    #else
+        using Reg = float;
+        constexpr const size_t WIDTH = 1;
+        inline auto load(const float* p) -> Reg { return *p; }
+        inline auto store(float* p, Reg v) -> void { *p = v; }
+        inline auto broadcast(float f) -> Reg { return f; }
+        inline auto fma(Reg a, Reg b, Reg c) -> Reg { return a * b + c; }
+        inline auto add(Reg a, Reg b) -> Reg { return a + b; }
+        inline auto max(Reg a, Reg b) -> Reg { return std::max(a, b); }
+    #endif
+        constexpr auto roundUp(size_t n) -> size_t {
+            return ((n + WIDTH - 1) / WIDTH) * WIDTH;
+        }
+    }
+
+    namespace Kernels {
+        constexpr const size_t ROW_BLOCK = 4; // rows sharing each loaded weight vector
+        constexpr const size_t COLUMN_VECTORS = 2; // weight vectors held per row in registers
+        constexpr const size_t K_BLOCK = 256; // input rows of the weight matrix kept hot in cache per pass
+
+        // out[r][c..] (+)= in[r][kBegin..kEnd) * weights[kBegin..kEnd)[c..]
+        // accumulators start from bias on the first k block and from the partial sums in out after that
+        template <size_t RB, size_t CV>
+        inline auto microKernel(
+            const float* in, size_t inStride,
+            const float* weights, size_t weightStride,
+            const float* bias,
+            float* out, size_t outStride,
+            size_t kBegin, size_t kEnd
+        ) -> void {
+            Simd::Reg acc[RB][CV];
+            for (size_t r = 0; r < RB; r++)
+                for (size_t v = 0; v < CV; v++)
+                    acc[r][v] = bias != nullptr
+                        ? Simd::load(bias + v * Simd::WIDTH)
+                        : Simd::load(out + r * outStride + v * Simd::WIDTH);
+            for (size_t k = kBegin; k < kEnd; k++) {
+                Simd::Reg w[CV];
+                for (size_t v = 0; v < CV; v++)
+                    w[v] = Simd::load(weights + k * weightStride + v * Simd::WIDTH);
+                for (size_t r = 0; r < RB; r++) {
+                    const Simd::Reg x = Simd::broadcast(in[r * inStride + k]);
+                    for (size_t v = 0; v < CV; v++)
+                        acc[r][v] = Simd::fma(x, w[v], acc[r][v]);
+                }
+            }
+            for (size_t r = 0; r < RB; r++)
+                for (size_t v = 0; v < CV; v++)
+                    Simd::store(out + r * outStride + v * Simd::WIDTH, acc[r][v]);
+        }
+        template <size_t RB>
+        inline auto rowBlock(
+            const float* in, size_t inStride,
+            const float* weights, size_t weightStride, size_t paddedUnits,
+            const float* bias,
+            float* out, size_t outStride,
+            size_t kBegin, size_t kEnd
+        ) -> void {
+            constexpr const size_t tile = COLUMN_VECTORS * Simd::WIDTH;
+            size_t c = 0;
+            for (; c + tile <= paddedUnits; c += tile)
+                microKernel<RB, COLUMN_VECTORS>(in, inStride, weights + c, weightStride,
+                    bias != nullptr ? bias + c : nullptr, out + c, outStride, kBegin, kEnd);
+            for (; c < paddedUnits; c += Simd::WIDTH)
+                microKernel<RB, 1>(in, inStride, weights + c, weightStride,
+                    bias != nullptr ? bias + c : nullptr, out + c, outStride, kBegin, kEnd);
+        }
+        // out = in * weights + bias over a batch. weights are (inputs x paddedUnits) row-major, zero padded,
+        // and out rows must hold paddedUnits floats
+        inline auto gemm(
+            const float* in, size_t inStride, size_t rows, size_t inputs,
+            const float* weights, size_t paddedUnits,
+            const float* bias,
+            float* out, size_t outStride
+        ) -> void {
+            if (inputs == 0) { // no products, only the bias
+                for (size_t r = 0; r < rows; r++)
+                    std::copy(bias, bias + paddedUnits, out + r * outStride);
+                return;
+            }
+            for (size_t kBegin = 0; kBegin < inputs; kBegin += K_BLOCK) {
+                const size_t kEnd = std::min(inputs, kBegin + K_BLOCK);
+                const float* b = kBegin == 0 ? bias : nullptr;
+                size_t r = 0;
+                for (; r + ROW_BLOCK <= rows; r += ROW_BLOCK)
+                    rowBlock<ROW_BLOCK>(in + r * inStride, inStride, weights, paddedUnits, paddedUnits,
+                        b, out + r * outStride, outStride, kBegin, kEnd);
+                for (; r < rows; r++)
+                    rowBlock<1>(in + r * inStride, inStride, weights, paddedUnits, paddedUnits,
+                        b, out + r * outStride, outStride, kBegin, kEnd);
+            }
+        }
+        inline auto addRow(const float* row, float* out, size_t paddedUnits) -> void {
+            for (size_t c = 0; c < paddedUnits; c += Simd::WIDTH)
+                Simd::store(out + c, Simd::add(Simd::load(row + c), Simd::load(out + c)));
+        }
+        inline auto activate(Activation activation, float* data, size_t stride, size_t rows, size_t units) -> void {
+            switch (activation) {
+            case Activation::LINEAR:
+                return;
+            case Activation::RELU: {
+                const Simd::Reg zero = Simd::broadcast(0.0f);
+                const size_t padded = Simd::roundUp(units); // rows are padded, so whole vectors are safe
+                for (size_t r = 0; r < rows; r++)
+                    for (size_t c = 0; c < padded; c += Simd::WIDTH)
+                        Simd::store(data + r * stride + c, Simd::max(zero, Simd::load(data + r * stride + c)));
+                return;
+            }
+            case Activation::SIGMOID:
+                for (size_t r = 0; r < rows; r++)
+                    for (size_t c = 0; c < units; c++)
+                        data[r * stride + c] = 1.0f / (1.0f + std::exp(-data[r * stride + c]));
+                return;
+            case Activation::TANH:
+                for (size_t r = 0; r < rows; r++)
+                    for (size_t c = 0; c < units; c++)
+                        data[r * stride + c] = std::tanh(data[r * stride + c]);
+                return;
+            case Activation::SOFTMAX:
+                for (size_t r = 0; r < rows; r++) {
+                    float* row = data + r * stride;
+                    const float m = *std::max_element(row, row + units);
+                    float sum = 0.0f;
+                    for (size_t c = 0; c < units; c++) {
+                        row[c] = std::exp(row[c] - m);
+                        sum += row[c];
+                    }
+                    for (size_t c = 0; c < units; c++)
+                        row[c] /= sum;
+                }
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "JsonUtils.hpp"
+#include "FrugallyDeepJson.hpp"
+#include "DenseKernels.hpp"
+
+namespace Inference {
+
+    struct DenseLayer {
+        uint32_t inputs;
+        uint32_t units;
+        uint32_t paddedUnits; // units rounded up to the simd width
+        std::vector<float> weights; // inputs x paddedUnits, row-major, zero padded
+        std::vector<float> bias; // paddedUnits, zero padded
+        Activation activation;
+    };
+
+    class DenseNetwork;
+
+    class DenseWorkspace { // per thread scratch space, never share between threads
+        friend class DenseNetwork;
+        const DenseNetwork* network;
+        size_t maxRows;
+        size_t stride;
+        std::vector<float> front;
+        std::vector<float> back;
+        // fixed columns: inputs that stay constant across many batches (the counting features of a grid point).
+        // their first layer contribution is folded into firstLayerBase so only the variable columns are multiplied.
+        // one hot groups: columns of which exactly one is 1. each row adds the weight row of its high column
+        bool incremental;
+        bool baseValid;
+        std::vector<uint32_t> fixedColumns;
+        std::vector<float> fixedValues;
+        std::vector<bool> fixedInBase; // false for fixed columns that belong to a one hot group
+        std::vector<std::vector<uint32_t>> oneHotGroups;
+        std::vector<uint32_t> variableColumns;
+        std::vector<float> variableWeights; // first layer rows of the variable columns, variableColumns x paddedUnits
+        std::vector<float> variableInputs; // maxRows x variableColumns
+        std::vector<float> firstLayerBase; // bias + fixed contributions, paddedUnits
+        // resident samples (common random numbers): the variable columns' first layer contribution of every row,
+        // without bias, so a grid point only adds its base
+        std::vector<float> cachedVariable; // cachedRows x paddedUnits
+        size_t cachedRows;
+
+        auto repack() -> void;
+        auto rebuildBase() -> void;
+        auto inOneHotGroup(uint32_t) const -> bool;
+    public:
+        constexpr static uint32_t NO_COLUMN = -1; // one hot group with nothing raised
+
+        DenseWorkspace();
+        DenseWorkspace(const DenseNetwork&, size_t);
+        auto getMaxRows() const -> size_t;
+        auto fixColumns(const std::vector<uint32_t>&) -> void;
+        auto setOneHotGroups(const std::vector<std::vector<uint32_t>>&) -> void;
+        auto setFixedInputs(const float*) -> void;
+        auto cacheVariableRows(const float*, size_t) -> void;
+    };
+
+    class DenseNetwork {
+        std::vector<DenseLayer> layers;
+        uint32_t inputSize;
+        uint32_t outputSize;
+        uint32_t widestLayer;
+
+        DenseNetwork(const std::vector<DenseLayerSpec>&);
+        auto forward(const float*, size_t, const uint32_t*, const float*, size_t, float*, DenseWorkspace&) const -> void;
+    public:
+        static auto load(const std::string&) -> std::optional<DenseNetwork>;
+        static auto fromJson(const json&, std::string&) -> std::optional<DenseNetwork>;
+
+        auto getInputSize() const -> uint32_t;
+        auto getOutputSize() const -> uint32_t;
+        auto getWidestLayer() const -> uint32_t;
+        auto getLayers() const -> const std::vector<DenseLayer>&;
+        auto predictBatch(const float*, size_t, float*, DenseWorkspace&) const -> void;
+        auto predictBatch(const float*, const uint32_t*, size_t, float*, DenseWorkspace&) const -> void;
+        auto predictCached(const float*, const uint32_t*, size_t, size_t, float*, DenseWorkspace&) const -> void;
+        auto createWorkspace(size_t) const -> DenseWorkspace;
+        auto cacheVariableRows(const float*, size_t, DenseWorkspace&) const -> void;
+        auto passesTests(const std::vector<ModelTestCase>&, float) const -> bool;
+    };
+
+    DenseWorkspace::DenseWorkspace()
+        : network(nullptr)
+        , maxRows(0)
+        , stride(0)
+        , incremental(false)
+        , baseValid(false)
+        , cachedRows(0)
+    {}
+    DenseWorkspace::DenseWorkspace(const DenseNetwork& network, size_t rows)
+        : network(&network)
+        , maxRows(std::max<size_t>(rows, 1))
+        , stride(Simd::roundUp(network.getWidestLayer()))
+        , incremental(false)
+        , baseValid(false)
+        , cachedRows(0)
+    {
+        this->front = std::vector<float>(this->maxRows * this->stride, 0.0f);
+        this->back = std::vector<float>(this->maxRows * this->stride, 0.0f);
+    }
+    auto DenseWorkspace::getMaxRows() const -> size_t {
+        return this->maxRows;
+    }
+    auto DenseWorkspace::fixColumns(const std::vector<uint32_t>& columns) -> void {
+        if (this->network == nullptr) return; // not running natively, nothing to cache
+        this->fixedColumns = std::vector<uint32_t>(columns);
+        this->fixedValues = std::vector<float>(columns.size(), 0.0f);
+        this->repack();
+    }
+    auto DenseWorkspace::setOneHotGroups(const std::vector<std::vector<uint32_t>>& groups) -> void {
+        if (this->network == nullptr) return;
+        this->oneHotGroups = std::vector<std::vector<uint32_t>>(groups);
+        this->repack();
+    }
+    auto DenseWorkspace::inOneHotGroup(uint32_t column) const -> bool {
+        for (const auto& group : this->oneHotGroups)
+            if (std::find(group.begin(), group.end(), column) != group.end())
+                return true;
+        return false;
+    }
+    auto DenseWorkspace::repack() -> void {
+        const auto& first = this->network->getLayers().front();
+        this->fixedInBase = std::vector<bool>(this->fixedColumns.size());
+        for (size_t j = 0; j < this->fixedColumns.size(); j++) // a group's high column is gathered per row instead
+            this->fixedInBase[j] = !this->inOneHotGroup(this->fixedColumns[j]);
+        this->variableColumns = std::vector<uint32_t>();
+        for (uint32_t c = 0; c < first.inputs; c++)
+            if (std::find(this->fixedColumns.begin(), this->fixedColumns.end(), c) == this->fixedColumns.end()
+                && !this->inOneHotGroup(c))
+                this->variableColumns.push_back(c);
+        this->variableWeights = std::vector<float>(this->variableColumns.size() * first.paddedUnits);
+        for (size_t v = 0; v < this->variableColumns.size(); v++)
+            std::copy(
+                first.weights.begin() + this->variableColumns[v] * first.paddedUnits,
+                first.weights.begin() + (this->variableColumns[v] + 1) * first.paddedUnits,
+                this->variableWeights.begin() + v * first.paddedUnits
+            );
+        this->variableInputs = std::vector<float>(this->maxRows * std::max<size_t>(this->variableColumns.size(), 1));
+        this->firstLayerBase = std::vector<float>(first.paddedUnits, 0.0f);
+        this->cachedRows = 0; // variable columns changed
+        this->incremental = true;
+        this->rebuildBase();
+        this->baseValid = this->fixedColumns.empty(); // otherwise set on the first setFixedInputs
+    }
+    auto DenseWorkspace::setFixedInputs(const float* values) -> void {
+        // values follow the order given to fixColumns. the base is recomputed from the values alone rather than
+        // patched with deltas, so a grid point's predictions don't depend on which points were evaluated before it
+        if (!this->incremental) return;
+        if (this->baseValid && std::equal(values, values + this->fixedColumns.size(), this->fixedValues.begin()))
+            return;
+        std::copy(values, values + this->fixedColumns.size(), this->fixedValues.begin());
+        this->rebuildBase();
+    }
+    auto DenseWorkspace::cacheVariableRows(const float* in, size_t rows) -> void {
+        // in is rows x network inputs. call after fixColumns and setOneHotGroups, the rows are then predicted by
+        // predictCached with only the counting point changing
+        if (!this->incremental) return;
+        const auto& first = this->network->getLayers().front();
+        const size_t variables = this->variableColumns.size();
+        const auto zeroBias = std::vector<float>(first.paddedUnits, 0.0f);
+        this->cachedVariable.resize(rows * first.paddedUnits);
+        for (size_t start = 0; start < rows; start += this->maxRows) {
+            const size_t count = std::min(this->maxRows, rows - start);
+            for (size_t r = 0; r < count; r++)
+                for (size_t v = 0; v < variables; v++)
+                    this->variableInputs[r * variables + v] = in[(start + r) * first.inputs + this->variableColumns[v]];
+            Kernels::gemm(this->variableInputs.data(), variables, count, variables, this->variableWeights.data(),
+                first.paddedUnits, zeroBias.data(), this->cachedVariable.data() + start * first.paddedUnits, first.paddedUnits);
+        }
+        this->cachedRows = rows;
+    }
+    auto DenseWorkspace::rebuildBase() -> void {
+        const auto& first = this->network->getLayers().front();
+        std::copy(first.bias.begin(), first.bias.end(), this->firstLayerBase.begin());
+        for (size_t j = 0; j < this->fixedColumns.size(); j++) {
+            if (!this->fixedInBase[j]) continue;
+            const float* w = first.weights.data() + this->fixedColumns[j] * first.paddedUnits;
+            const Simd::Reg x = Simd::broadcast(this->fixedValues[j]);
+            for (size_t c = 0; c < first.paddedUnits; c += Simd::WIDTH)
+                Simd::store(this->firstLayerBase.data() + c, Simd::fma(x, Simd::load(w + c), Simd::load(this->firstLayerBase.data() + c)));
+        }
+        this->baseValid = true;
+    }
+
+    DenseNetwork::DenseNetwork(const std::vector<DenseLayerSpec>& specs) {
+        this->layers = std::vector<DenseLayer>();
+        this->layers.reserve(specs.size());
+        this->inputSize = specs.front().inputs;
+        this->outputSize = specs.back().units;
+        this->widestLayer = 0;
+        for (const auto& spec : specs) { // repack weights into the layout the kernels stream over
+            DenseLayer layer;
+            layer.inputs = spec.inputs;
+            layer.units = spec.units;
+            layer.paddedUnits = Simd::roundUp(spec.units);
+            layer.activation = spec.activation;
+            layer.weights = std::vector<float>((size_t) layer.inputs * layer.paddedUnits, 0.0f);
+            for (size_t k = 0; k < layer.inputs; k++)
+                std::copy(
+                    spec.weights.begin() + k * spec.units,
+                    spec.weights.begin() + (k + 1) * spec.units,
+                    layer.weights.begin() + k * layer.paddedUnits
+                );
+            layer.bias = std::vector<float>(layer.paddedUnits, 0.0f);
+            std::copy(spec.bias.begin(), spec.bias.end(), layer.bias.begin());
+            this->widestLayer = std::max(this->widestLayer, layer.units);
+            this->layers.push_back(std::move(layer));
+        }
+    }
+    auto DenseNetwork::load(const std::string& path) -> std::optional<DenseNetwork> {
+        std::string reason = "";
+        auto network = fromJson(JsonUtils::readJsonFile(path), reason);
+        if (!network.has_value())
+            std::cout << "Native inference unavailable for " << path << " (" << reason << "). Using frugally-deep." << std::endl;
+        return network;
+    }
+    auto DenseNetwork::fromJson(const json& j, std::string& reason) -> std::optional<DenseNetwork> {
+        // a layout the reader doesn't expect (missing keys, keras 3 batch_shape, dict inbound_nodes...) is "not
+        // supported" like any other, never an exception: Model is built at namespace scope and falls back to fdeep
+        try {
+            auto specs = std::vector<DenseLayerSpec>();
+            if (!FrugallyDeepJson::readSequentialDenseModel(j, specs, reason))
+                return std::nullopt;
+            auto network = DenseNetwork(specs);
+            if (!network.passesTests(FrugallyDeepJson::readTestCases(j), 1e-4f)) { // same check fdeep::load_model does
+                reason = "embedded test cases failed";
+                return std::nullopt;
+            }
+            return network;
+        }
+        catch (const json::exception& e) {
+            reason = std::string("unexpected model layout, ") + e.what();
+        }
+        catch (const std::invalid_argument& e) { // bad base64 weights
+            reason = e.what();
+        }
+        return std::nullopt;
+    }
+    auto DenseNetwork::getInputSize() const -> uint32_t {
+        return this->inputSize;
+    }
+    auto DenseNetwork::getOutputSize() const -> uint32_t {
+        return this->outputSize;
+    }
+    auto DenseNetwork::getWidestLayer() const -> uint32_t {
+        return this->widestLayer;
+    }
+    auto DenseNetwork::getLayers() const -> const std::vector<DenseLayer>& {
+        return this->layers;
+    }
+    auto DenseNetwork::forward(const float* in, size_t inStride, const uint32_t* oneHotActive, const float* cached, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        // activations ping-pong between the workspace buffers, the last layer's rows are copied out unpadded.
+        // cached, if given, holds the rows' variable column contributions from cacheVariableRows
+        const float* src = in;
+        size_t srcStride = inStride;
+        float* dst = ws.front.data();
+        for (size_t l = 0; l < this->layers.size(); l++) {
+            const auto& layer = this->layers[l];
+            const bool oneHotReady = ws.oneHotGroups.empty() || oneHotActive != nullptr;
+            if (l == 0 && ws.incremental && ws.baseValid && oneHotReady) { // only the variable columns are multiplied
+                if (cached != nullptr) { // or not even those
+                    for (size_t r = 0; r < rows; r++) {
+                        std::copy(ws.firstLayerBase.begin(), ws.firstLayerBase.end(), dst + r * ws.stride);
+                        Kernels::addRow(cached + r * layer.paddedUnits, dst + r * ws.stride, layer.paddedUnits);
+                    }
+                }
+                else {
+                    const size_t variables = ws.variableColumns.size();
+                    for (size_t r = 0; r < rows; r++)
+                        for (size_t v = 0; v < variables; v++)
+                            ws.variableInputs[r * variables + v] = src[r * srcStride + ws.variableColumns[v]];
+                    Kernels::gemm(ws.variableInputs.data(), variables, rows, variables, ws.variableWeights.data(),
+                        layer.paddedUnits, ws.firstLayerBase.data(), dst, ws.stride);
+                }
+                const size_t groups = ws.oneHotGroups.size();
+                for (size_t r = 0; r < rows; r++) // one weight row per group instead of a multiply per member
+                    for (size_t g = 0; g < groups; g++) {
+                        const uint32_t column = oneHotActive[r * groups + g];
+                        if (column != DenseWorkspace::NO_COLUMN)
+                            Kernels::addRow(layer.weights.data() + column * layer.paddedUnits, dst + r * ws.stride, layer.paddedUnits);
+                    }
+            }
+            else
+                Kernels::gemm(src, srcStride, rows, layer.inputs, layer.weights.data(), layer.paddedUnits,
+                    layer.bias.data(), dst, ws.stride);
+            Kernels::activate(layer.activation, dst, ws.stride, rows, layer.units);
+            src = dst;
+            srcStride = ws.stride;
+            dst = dst == ws.front.data() ? ws.back.data() : ws.front.data();
+        }
+        for (size_t r = 0; r < rows; r++)
+            std::copy(src + r * srcStride, src + r * srcStride + this->outputSize, out + r * this->outputSize);
+    }
+    auto DenseNetwork::predictBatch(const float* in, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        this->predictBatch(in, nullptr, rows, out, ws);
+    }
+    auto DenseNetwork::predictBatch(const float* in, const uint32_t* oneHotActive, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        // in is rows x inputSize, out is rows x outputSize. oneHotActive, if given, is rows x one hot groups and holds
+        // the raised column of each group. batches larger than the workspace run in chunks
+        const size_t groups = ws.oneHotGroups.size();
+        for (size_t start = 0; start < rows; start += ws.maxRows) {
+            const size_t count = std::min(ws.maxRows, rows - start);
+            this->forward(in + start * this->inputSize, this->inputSize,
+                oneHotActive != nullptr ? oneHotActive + start * groups : nullptr, nullptr,
+                count, out + start * this->outputSize, ws);
+        }
+    }
+    auto DenseNetwork::predictCached(const float* in, const uint32_t* oneHotActive, size_t firstRow, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        // predictBatch of rows firstRow.. of the matrix given to cacheVariableRows, in and oneHotActive pointing at
+        // those rows. in is only read when the cache can't be used
+        const size_t groups = ws.oneHotGroups.size();
+        const bool usable = firstRow + rows <= ws.cachedRows;
+        for (size_t start = 0; start < rows; start += ws.maxRows) {
+            const size_t count = std::min(ws.maxRows, rows - start);
+            this->forward(in + start * this->inputSize, this->inputSize,
+                oneHotActive != nullptr ? oneHotActive + start * groups : nullptr,
+                usable ? ws.cachedVariable.data() + (firstRow + start) * this->layers.front().paddedUnits : nullptr,
+                count, out + start * this->outputSize, ws);
+        }
+    }
+    auto DenseNetwork::createWorkspace(size_t maxRows) const -> DenseWorkspace { // as Model's, so code written for Model runs on a DenseNetwork
+        return DenseWorkspace(*this, maxRows);
+    }
+    auto DenseNetwork::cacheVariableRows(const float* in, size_t rows, DenseWorkspace& ws) const -> void {
+        ws.cacheVariableRows(in, rows);
+    }
+    auto DenseNetwork::passesTests(const std::vector<ModelTestCase>& tests, float epsilon) const -> bool {
+        auto ws = DenseWorkspace(*this, 1);
+        auto out = std::vector<float>(this->outputSize);
+        for (const auto& test : tests) {
+            if (test.input.size() != this->inputSize || test.output.size() != this->outputSize)
+                return false;
+            this->predictBatch(test.input.data(), 1, out.data(), ws);
+            for (size_t i = 0; i < out.size(); i++)
+                if (std::abs(out[i] - test.output[i]) > epsilon * std::max(1.0f, std::abs(test.output[i])))
+                    return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include "FrugallyDeepJson.hpp"
+
+namespace Inference {
+    // forward pass of a dense stack whose shape and weights are known at compile time.
+    // ModelCompiler emits a header that instantiates these with the model's weights as constexpr arrays,
+    // so every loop bound is a constant and nothing is allocated per prediction
+    template <uint32_t Inputs, uint32_t Units, Activation Act, const float (&Weights)[Inputs * Units], const float (&Bias)[Units]>
+    struct FixedDenseLayer {
+        static constexpr const uint32_t INPUTS = Inputs;
+        static constexpr const uint32_t UNITS = Units;
+
+        static auto apply(const float* in, float* out) -> void {
+            std::array<float, Units> acc;
+            for (uint32_t o = 0; o < Units; o++)
+                acc[o] = Bias[o];
+            for (uint32_t k = 0; k < Inputs; k++) { // row of the kernel at a time, vectorizes over units
+                const float x = in[k];
+                for (uint32_t o = 0; o < Units; o++)
+                    acc[o] += x * Weights[k * Units + o];
+            }
+            if constexpr (Act == Activation::RELU) {
+                for (uint32_t o = 0; o < Units; o++)
+                    acc[o] = std::max(acc[o], 0.0f);
+            }
+            else if constexpr (Act == Activation::SIGMOID) {
+                for (uint32_t o = 0; o < Units; o++)
+                    acc[o] = 1.0f / (1.0f + std::exp(-acc[o]));
+            }
+            else if constexpr (Act == Activation::TANH) {
+                for (uint32_t o = 0; o < Units; o++)
+                    acc[o] = std::tanh(acc[o]);
+            }
+            else if constexpr (Act == Activation::SOFTMAX) {
+                const float m = *std::max_element(acc.begin(), acc.end());
+                float sum = 0.0f;
+                for (uint32_t o = 0; o < Units; o++) {
+                    acc[o] = std::exp(acc[o] - m);
+                    sum += acc[o];
+                }
+                for (uint32_t o = 0; o < Units; o++)
+                    acc[o] /= sum;
+            }
+            else { // Activation::LINEAR
+            }
+            std::copy(acc.begin(), acc.end(), out);
+        }
+    };
+
+    template <typename... Layers>
+    struct FixedDenseNetwork;
+
+    template <typename Last>
+    struct FixedDenseNetwork<Last> {
+        static constexpr const uint32_t INPUT_SIZE = Last::INPUTS;
+        static constexpr const uint32_t OUTPUT_SIZE = Last::UNITS;
+
+        static auto predict(const float* in, float* out) -> void {
+            Last::apply(in, out);
+        }
+        static auto predictBatch(const float* in, size_t rows, float* out) -> void {
+            for (size_t r = 0; r < rows; r++)
+                predict(in + r * INPUT_SIZE, out + r * OUTPUT_SIZE);
+        }
+    };
+    template <typename First, typename Second, typename... Rest>
+    struct FixedDenseNetwork<First, Second, Rest...> {
+        using Next = FixedDenseNetwork<Second, Rest...>;
+        static_assert(First::UNITS == Second::INPUTS, "Consecutive layers must agree on their width");
+        static constexpr const uint32_t INPUT_SIZE = First::INPUTS;
+        static constexpr const uint32_t OUTPUT_SIZE = Next::OUTPUT_SIZE;
+
+        static auto predict(const float* in, float* out) -> void {
+            std::array<float, First::UNITS> hidden; // lives on the stack
+            First::apply(in, hidden.data());
+            Next::predict(hidden.data(), out);
+        }
+        static auto predictBatch(const float* in, size_t rows, float* out) -> void {
+            for (size_t r = 0; r < rows; r++)
+                predict(in + r * INPUT_SIZE, out + r * OUTPUT_SIZE);
+        }
+    };
+}
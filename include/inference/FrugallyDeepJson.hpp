@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "JsonUtils.hpp"
+
+namespace Inference {
+
+    enum class Activation {
+        LINEAR,
+        RELU,
+        SIGMOID,
+        TANH,
+        SOFTMAX
+    };
+
+    struct DenseLayerSpec {
+        std::string name;
+        uint32_t inputs;
+        uint32_t units;
+        std::vector<float> weights; // inputs x units, row-major (keras kernel layout)
+        std::vector<float> bias; // units
+        Activation activation;
+    };
+
+    struct ModelTestCase {
+        std::vector<float> input;
+        std::vector<float> output;
+    };
+
+    namespace FrugallyDeepJson {
+
+        auto decodeBase64(const std::string&, std::vector<uint8_t>&) -> bool;
+        auto decodeFloats(const json&) -> std::vector<float>;
+        auto parseActivation(const std::string&, Activation&) -> bool;
+        auto readSequentialDenseModel(const json&, std::vector<DenseLayerSpec>&, std::string&) -> bool;
+        auto readTestCases(const json&) -> std::vector<ModelTestCase>;
+
+        auto decodeBase64(const std::string& in, std::vector<uint8_t>& out) -> bool {
+            auto sextet = [](char c) -> int32_t {
+                if (c >= 'A' && c <= 'Z') return c - 'A';
+                if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+                if (c >= '0' && c <= '9') return c - '0' + 52;
+                if (c == '+') return 62;
+                if (c == '/') return 63;
+                return -1;
+            };
+            uint32_t buffer = 0;
+            uint32_t bits = 0;
+            for (const char c : in) {
+                if (c == '=') break; // padding, rest carries no data
+                const int32_t v = sextet(c);
+                if (v < 0) return false;
+                buffer = (buffer << 6) | (uint32_t) v;
+                bits += 6;
+                if (bits >= 8) {
+                    bits -= 8;
+                    out.push_back((uint8_t) ((buffer >> bits) & 0xFF));
+                }
+            }
+            return true;
+        }
+        auto decodeFloats(const json& j) -> std::vector<float> {
+            // frugally-deep stores float32 arrays as a list of base64 chunks (older exports use plain numbers)
+            auto ret = std::vector<float>();
+            auto bytes = std::vector<uint8_t>();
+            for (const auto& chunk : j) {
+                if (chunk.is_string()) {
+                    bytes.clear();
+                    if (!decodeBase64(chunk.get<std::string>(), bytes))
+                        throw std::invalid_argument("Invalid base64 float array in model file.");
+                    const auto count = bytes.size() / sizeof(float);
+                    const auto offset = ret.size();
+                    ret.resize(offset + count);
+                    std::memcpy(ret.data() + offset, bytes.data(), count * sizeof(float)); // little endian, as written by keras
+                }
+                else
+                    ret.push_back(chunk.get<float>());
+            }
+            return ret;
+        }
+        auto parseActivation(const std::string& name, Activation& out) -> bool {
+            if (name == "linear") out = Activation::LINEAR;
+            else if (name == "relu") out = Activation::RELU;
+            else if (name == "sigmoid") out = Activation::SIGMOID;
+            else if (name == "tanh") out = Activation::TANH;
+            else if (name == "softmax") out = Activation::SOFTMAX;
+            else return false;
+            return true;
+        }
+        auto readSequentialDenseModel(const json& j, std::vector<DenseLayerSpec>& layers, std::string& reason) -> bool {
+            // accepts a single chain of InputLayer -> (Dense | Activation | Dropout)*, which is every model this project runs
+            const auto& config = j.at("architecture").at("config");
+            const auto& params = j.at("trainable_params");
+            uint32_t width = 0;
+            std::string previous = "";
+            for (const auto& layer : config.at("layers")) {
+                const auto className = layer.at("class_name").get<std::string>();
+                const auto& layerConfig = layer.at("config");
+                const auto name = layer.contains("name")
+                    ? layer.at("name").get<std::string>()
+                    : layerConfig.at("name").get<std::string>();
+                if (layer.contains("inbound_nodes") && previous != "") { // functional models must still be a chain
+                    const auto& inbound = layer.at("inbound_nodes");
+                    if (inbound.size() != 1 || inbound[0].size() != 1 || inbound[0][0][0].get<std::string>() != previous) {
+                        reason = "layer " + name + " is not fed by the previous layer only";
+                        return false;
+                    }
+                }
+                if (className == "InputLayer") {
+                    const auto& shape = layerConfig.at("batch_input_shape");
+                    if (shape.size() != 2) {
+                        reason = "input is not one dimensional";
+                        return false;
+                    }
+                    width = shape[1].get<uint32_t>();
+                }
+                else if (className == "Dense") {
+                    DenseLayerSpec spec;
+                    spec.name = name;
+                    spec.inputs = width;
+                    spec.units = layerConfig.at("units").get<uint32_t>();
+                    if (!parseActivation(layerConfig.at("activation").get<std::string>(), spec.activation)) {
+                        reason = "unsupported activation " + layerConfig.at("activation").get<std::string>();
+                        return false;
+                    }
+                    spec.weights = decodeFloats(params.at(name).at("weights"));
+                    if (layerConfig.value("use_bias", true))
+                        spec.bias = decodeFloats(params.at(name).at("bias"));
+                    else
+                        spec.bias = std::vector<float>(spec.units, 0.0f);
+                    if (spec.weights.size() != (size_t) spec.inputs * spec.units || spec.bias.size() != spec.units) {
+                        reason = "weights of " + name + " do not match its shape";
+                        return false;
+                    }
+                    width = spec.units;
+                    layers.push_back(std::move(spec));
+                }
+                else if (className == "Activation") { // folded into the dense layer before it
+                    Activation act;
+                    if (layers.empty() || layers.back().activation != Activation::LINEAR
+                        || !parseActivation(layerConfig.at("activation").get<std::string>(), act)) {
+                        reason = "activation layer " + name + " can't be folded into a dense layer";
+                        return false;
+                    }
+                    layers.back().activation = act;
+                }
+                else if (className != "Dropout") { // dropout is a no-op at inference
+                    reason = "unsupported layer type " + className;
+                    return false;
+                }
+                previous = name;
+            }
+            if (layers.empty() || width == 0) {
+                reason = "model has no dense layers";
+                return false;
+            }
+            return true;
+        }
+        auto readTestCases(const json& j) -> std::vector<ModelTestCase> {
+            auto ret = std::vector<ModelTestCase>();
+            if (!j.contains("tests")) return ret;
+            for (const auto& test : j.at("tests")) {
+                if (test.at("inputs").size() != 1 || test.at("outputs").size() != 1) continue;
+                ModelTestCase c;
+                c.input = decodeFloats(test.at("inputs")[0].at("values"));
+                c.output = decodeFloats(test.at("outputs")[0].at("values"));
+                ret.push_back(std::move(c));
+            }
+            return ret;
+        }
+    }
+}
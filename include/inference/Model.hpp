@@ -0,0 +1,117 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fplus/fplus.hpp>
+#include <fdeep/fdeep.hpp>
+
+#include "JsonUtils.hpp"
+#include "DenseNetwork.hpp"
+
+namespace Inference {
+    // runs a frugally-deep model file on the native dense engine when the model is a plain dense stack,
+    // and through fdeep otherwise
+    class Model {
+        fdeep::model fallback;
+        std::optional<DenseNetwork> native;
+        uint32_t inputSize;
+        uint32_t outputSize;
+    public:
+        Model(const std::string&, bool = true);
+
+        auto isNative() const -> bool;
+        auto getInputSize() const -> uint32_t;
+        auto getOutputSize() const -> uint32_t;
+        auto getCostPerSample() const -> double;
+        auto createWorkspace(size_t) const -> DenseWorkspace;
+        auto predict(const std::vector<float>&) const -> std::vector<float>;
+        auto predictBatch(const float*, size_t, float*, DenseWorkspace&) const -> void;
+        auto predictBatch(const float*, const uint32_t*, size_t, float*, DenseWorkspace&) const -> void;
+        auto cacheVariableRows(const float*, size_t, DenseWorkspace&) const -> void;
+        auto predictCached(const float*, const uint32_t*, size_t, size_t, float*, DenseWorkspace&) const -> void;
+    };
+
+    Model::Model(const std::string& path, bool allowNative)
+        : fallback(fdeep::load_model(path))
+        , native(std::nullopt)
+    {
+        const auto j = JsonUtils::readJsonFile(path);
+        this->inputSize = j.at("input_shapes").at(0).back().get<uint32_t>();
+        this->outputSize = j.at("output_shapes").at(0).back().get<uint32_t>();
+        if (allowNative)
+            this->native = DenseNetwork::load(path);
+    }
+    auto Model::isNative() const -> bool {
+        return this->native.has_value();
+    }
+    auto Model::getInputSize() const -> uint32_t {
+        return this->inputSize;
+    }
+    auto Model::getOutputSize() const -> uint32_t {
+        return this->outputSize;
+    }
+    auto Model::getCostPerSample() const -> double { // multiply-adds for one row, for comparing task sizes
+        if (!this->native.has_value())
+            return (double) this->inputSize * this->outputSize; // layers unknown, only relative sizes matter
+        double cost = 0;
+        for (const auto& layer : this->native.value().getLayers())
+            cost += (double) layer.inputs * layer.units;
+        return cost;
+    }
+    auto Model::createWorkspace(size_t maxRows) const -> DenseWorkspace {
+        if (this->native.has_value())
+            return DenseWorkspace(this->native.value(), maxRows);
+        return DenseWorkspace(); // fdeep allocates its own
+    }
+    auto Model::predict(const std::vector<float>& input) const -> std::vector<float> {
+        if (input.size() != this->inputSize)
+            throw std::invalid_argument("Model expects " + std::to_string(this->inputSize)
+                + " inputs but got " + std::to_string(input.size()));
+        auto out = std::vector<float>(this->outputSize);
+        auto ws = this->createWorkspace(1);
+        this->predictBatch(input.data(), 1, out.data(), ws);
+        return out;
+    }
+    auto Model::predictBatch(const float* in, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        this->predictBatch(in, nullptr, rows, out, ws);
+    }
+    auto Model::predictBatch(const float* in, const uint32_t* oneHotActive, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        // in is rows x inputSize, out is rows x outputSize. oneHotActive only speeds up the native engine,
+        // in must still hold every column
+        if (this->native.has_value()) {
+            this->native->predictBatch(in, oneHotActive, rows, out, ws);
+            return;
+        }
+        // fdeep checks every input against the model's single sample shape, so rows are handed over as one
+        // predict_multi call rather than a tensor with a batch dimension
+        auto inputs = std::vector<fdeep::tensors>();
+        inputs.reserve(rows);
+        for (size_t r = 0; r < rows; r++) {
+            const auto sharedRow = fplus::make_shared_ref<fdeep::float_vec>(
+                in + r * this->inputSize,
+                in + (r + 1) * this->inputSize
+            );
+            inputs.push_back({fdeep::tensor(fdeep::tensor_shape(this->inputSize), sharedRow)});
+        }
+        const auto results = this->fallback.predict_multi(inputs, false); // callers already run inside threadpool tasks
+        for (size_t r = 0; r < rows; r++) {
+            const auto res = results.at(r).at(0).to_vector();
+            std::copy(res.begin(), res.end(), out + r * this->outputSize);
+        }
+    }
+    auto Model::cacheVariableRows(const float* in, size_t rows, DenseWorkspace& ws) const -> void {
+        if (this->native.has_value())
+            ws.cacheVariableRows(in, rows);
+    }
+    auto Model::predictCached(const float* in, const uint32_t* oneHotActive, size_t firstRow, size_t rows, float* out, DenseWorkspace& ws) const -> void {
+        // rows firstRow.. of the matrix given to cacheVariableRows, in and oneHotActive pointing at those rows.
+        // fdeep has no cache and predicts in whole
+        if (this->native.has_value()) {
+            this->native->predictCached(in, oneHotActive, firstRow, rows, out, ws);
+            return;
+        }
+        this->predictBatch(in, oneHotActive, rows, out, ws);
+    }
+}
@@ -4,8 +4,12 @@
 #include <float.h>
 
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <type_traits>
@@ -19,70 +23,141 @@
 
 #include "Domain.hpp"
 #include "TrialManager.hpp"
-#include "mt19937Singleton.hpp"
+#include "RandomGenerator.hpp"
 #include "stats.hpp"
 #include "TimeManager.hpp"
 #include "ThreadPool.hpp"
 #include "StatsTracker.hpp"
 #include "JsonUtils.hpp"
 #include "ModelFeatureJsonUtils.hpp"
+#include "Model.hpp"
+#include "fullSearchPoint.hpp" // settings, and the sampling and stats of one grid point
 
 namespace FullSearch {
 
-    constexpr const uint32_t    SAMPLES_PER_POINT               = 3000;
-    constexpr const uint32_t    STARTN                          = 7; // min 1
-    constexpr const uint32_t    MAXN                            = 7;
-    constexpr const uint32_t    MAX_NONRUNNING_TASKS            = 16;
-    constexpr const uint32_t    BATCH_WRITE_SIZE                = 32;
-    constexpr const uint32_t    MAX_THREADS_IN_THREADPOOL       = 8;
+    const auto model = Inference::Model(MODEL_PATH, NATIVE_INFERENCE); // load model once
 
-    constexpr const bool        PREDICTION_DEBUG                = false;
+    struct PairOutput { // one pair's output file. chunks finish in any order but are appended in grid order
+        std::mutex lock;
+        const std::string fileName; // working destination
+        const std::string finalFileName;
+        const uint64_t chunks;
+        uint64_t nextChunk; // first chunk not yet in the file
+        std::map<uint64_t, std::vector<json>> pending; // finished early
 
-    constexpr const bool        ROUND_PREDICTION_RESULTS        = false;
-    constexpr const bool        TEMP_DECODING_STAGE             = false;
-    constexpr const bool        TEMP_DECODING_STAGE_2           = false;
+        PairOutput(const std::string&, const std::string&, uint64_t);
+        auto complete(uint64_t, std::vector<json>&&) -> void;
+    };
 
-    constexpr const bool        IRIS_MODEL                      = false;
-    constexpr const bool        NBI_MODEL                       = true;
-    constexpr const bool        WINE_MODEL                      = false;
+    struct PlannedTask { // one chunk of one pair, queued largest cost first
+        std::vector<std::string> linears;
+        uint32_t n;
+        uint64_t chunk;
+        uint64_t first; // grid points [first, last)
+        uint64_t last;
+        uint64_t samplesPerPoint;
+        double cost; // multiply-adds, points x samples x model cost per sample
+        std::shared_ptr<PairOutput> output;
+        std::shared_ptr<const json> previous; // COARSE_TO_FINE, the pair's output at n - 1. null computes every point
+    };
 
-    constexpr const auto        MODEL_PATH                      = "../in/saved_model.json";
-    constexpr const auto        FEATURE_DOMAIN_CONSTRAINT_PATH  = "../in/features.json";
-
-    constexpr const bool        VALID                           = STARTN >= 1 && STARTN <= MAXN;
-
-    const auto model = fdeep::load_model(MODEL_PATH); // load model once
-    std::vector<std::string> STATS_KEYS;
+    struct RefineCell { // ADAPTIVE_REFINEMENT, a square of the continuous counting features at one n
+        uint32_t n;
+        uint64_t lower; // MAXN grid index of the corner with the lowest numerators
+        std::vector<size_t> children; // 2^continuous cells at n + 1, into the pair's cell list. empty for leaves
+    };
 
     auto program() -> int;
+    auto coarseOutput(const std::vector<std::string>&, uint32_t, uint64_t) -> std::shared_ptr<const json>;
+    auto logTaskTime(const PlannedTask&, double) -> void;
     auto allDiscrete(const std::vector<std::string>&, const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>&) -> bool;
     auto thread_start(
         const std::vector<std::string>&,
         const std::vector<std::string>&,
         const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>&,
         const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>&,
-        uint32_t
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>&,
+        uint32_t,
+        uint64_t,
+        uint64_t,
+        uint64_t,
+        PairOutput&,
+        const json*
+    ) -> void;
+    auto refinePair(
+        ThreadManagement::ThreadPool&,
+        const std::vector<std::string>&,
+        const std::vector<std::string>&,
+        const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>&,
+        const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>&,
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>&
     ) -> void;
-    auto iterate(TrialManager&, std::pair<std::vector<double>, Stats::StatsTracker>&) -> bool;
-    auto appendToJsonFile(const std::string&, const std::vector<std::pair<std::vector<double>, Stats::StatsTracker>>&) -> bool;
-    auto getPrediction(std::vector<std::variant<double, int64_t>>&, Stats::StatsTracker&) -> double;
+    auto evaluatePoints(
+        const std::vector<std::string>&,
+        const std::vector<std::string>&,
+        const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>&,
+        const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>&,
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>&,
+        uint32_t,
+        const uint64_t*,
+        size_t
+    ) -> std::vector<json>;
+    auto needsRefinement(const std::vector<const json*>&) -> bool;
+    auto configure(TrialManager&, uint32_t, const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>&) -> void;
+    auto streamKey(const std::vector<std::string>&, uint32_t) -> uint64_t;
+    auto appendToJsonFile(const std::string&, const std::vector<json>&) -> bool;
+
+    PairOutput::PairOutput(const std::string& working, const std::string& final, uint64_t chunkCount)
+        : fileName(working)
+        , finalFileName(final)
+        , chunks(chunkCount)
+        , nextChunk(0)
+    {
+        std::ifstream checkIfAlreadyExists(this->fileName); // check if file already exists
+        if (!checkIfAlreadyExists.good()) { // doesn't exist
+            checkIfAlreadyExists.close();
+            std::ofstream initJson(this->fileName);
+            initJson << "[]" << std::endl;
+            initJson.close(); // guarentee out file exists
+            std::cout << "\tshould have written file: " << this->fileName << std::endl;
+        }
+        else { // exists, no change required
+            checkIfAlreadyExists.close();
+        }
+    }
+    auto PairOutput::complete(uint64_t chunk, std::vector<json>&& data) -> void {
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->pending.emplace(chunk, std::move(data));
+        for (auto next = this->pending.find(this->nextChunk); next != this->pending.end(); next = this->pending.find(this->nextChunk)) {
+            appendToJsonFile(this->fileName, next->second); // assume success for now
+            this->pending.erase(next);
+            this->nextChunk++;
+        }
+        if (this->nextChunk == this->chunks) { // last chunk in, pair done
+            int code = rename(this->fileName.c_str(), this->finalFileName.c_str()); // attempt to move from working to out
+            std::cout << "\t" << this->finalFileName << " complete. Write Code: " << std::to_string(code) << std::endl;
+        }
+    }
 
     auto program() -> int {
         static_assert(VALID, "Invalid configuration. STARTN must be greater than 0 but less than MAXN");
         std::cout << "Hello World!" << std::endl;
-        if constexpr (IRIS_MODEL)
-            STATS_KEYS = std::vector<std::string> {"setosa", "versicolor", "virginica"};
-        else if constexpr (NBI_MODEL)
-            STATS_KEYS = std::vector<std::string> {"repair", "not_repair"};
-        else if constexpr (WINE_MODEL)
-            STATS_KEYS = std::vector<std::string> {"quality"};
+        STATS_KEYS = statsKeys();
         auto tm = TimeManagers::TimeManager();
         tm.printCurrentTimeAndDate();
+        #ifdef COMPILED_MODEL
+        if (CompiledModel::INPUT_SIZE != model.getInputSize() || CompiledModel::OUTPUT_SIZE != model.getOutputSize()) {
+            std::cout << "Compiled model doesn't match " << MODEL_PATH << ". Rebuild with the same model." << std::endl;
+            return 0;
+        }
+        std::cout << "Using compiled model." << std::endl;
+        #endif
 
         const auto input = ModelFeatureJsonUtils::readInputFile(std::string(FEATURE_DOMAIN_CONSTRAINT_PATH));
         auto features = ModelFeatureJsonUtils::getFeaturesFromInput(input);
         auto featuresAndDomains = ModelFeatureJsonUtils::getFeaturesAndDomainsFromInput(input);
         auto constrainedFeatures = ModelFeatureJsonUtils::getConstraintedFeaturesFromInput(input);
+        auto distributions = ModelFeatureJsonUtils::getDistributionsFromInput(input); // features without a histogram stay uniform
 
         std::cout << "feature input order in model:" << std::endl;
         for (const auto f : features) {
@@ -92,14 +167,20 @@ namespace FullSearch {
 
         // a set of discrete values only needs to be computed once, as changes to N don't affect them
         auto discreteSets = std::vector<std::vector<std::string>>();
-        ThreadManagement::ThreadPool* tp = new ThreadManagement::ThreadPool(MAX_THREADS_IN_THREADPOOL);
+        // queueing blocks while MAX_NONRUNNING_TASKS wait, so ram doesn't overflow with tasks data
+        ThreadManagement::ThreadPool* tp = new ThreadManagement::ThreadPool(MAX_THREADS_IN_THREADPOOL, MAX_NONRUNNING_TASKS);
         const size_t len = features.size();
+        const double costPerSample = model.getCostPerSample();
+        auto plan = std::vector<PlannedTask>();
+        std::ofstream(TASK_LOG_PATH) << "n,pair,chunk,points,samples_per_point,estimated_cost,seconds" << std::endl;
         tm.markTime();
         //return;
-        // n 1-MAXN (inclusive) across a set of linears are seperate jobs. Currently race condition on which n completes first
-        // if num_features pick 2 > number of threads in ThreadPool, this race condition disappears as nth jobs
-        // will be tasked and completed before n+1th jobs are tasked
-        for (size_t n = STARTN; n <= MAXN; n++) {
+        // n 1-MAXN (inclusive) across a set of linears are seperate jobs. every chunk of every job is planned first,
+        // then queued longest first, so the biggest pairs can't start last and leave the run on one thread.
+        // COARSE_TO_FINE plans and finishes one n at a time instead, as each n reads the outputs of the last.
+        // ADAPTIVE_REFINEMENT walks the pairs once, with a task per pair that refines from STARTN to MAXN itself
+        const size_t lastN = ADAPTIVE_REFINEMENT ? STARTN : MAXN;
+        for (size_t n = STARTN; n <= lastN; n++) {
             // per n, creates binomial coefficient of (F+1 choose 2) tasks. Linear additional jobs per n
             for (size_t i = 0; i < len; i++) { // first lin index
                 for (size_t j = i + 1; j < len; j++) { // second lin index
@@ -136,28 +217,103 @@ namespace FullSearch {
                         discreteSets.push_back(linears);
                     std::cout << linears[0] << linears[1] << std::endl;
                     // pointer required because TrailManager's Copy constructor is wrong. Pointer avoids the copy to new thread.
-
-                    while (tp->unassignedTasks() >= MAX_NONRUNNING_TASKS) {
-                        std::this_thread::yield(); // if too many tasks, yield cpu time to avoid overflowing ram with tasks data
+                    if constexpr (ADAPTIVE_REFINEMENT) { // its points run as nested tasks, the task waits on them helping out
+                        tp->queueTask([tp, linears, features, featuresAndDomains, constrainedFeatures, distributions]() {
+                            refinePair(*tp, linears, features, featuresAndDomains, constrainedFeatures, distributions);
+                        });
+                        continue;
                     }
-                    std::cout << "\tqueueing task to threadpool" << "\n\tn: " << n << std::endl;
 
-                    tp->queueTask([linears, features, featuresAndDomains, constrainedFeatures, n]() {
-                        thread_start(linears, features, featuresAndDomains, constrainedFeatures, n);
-                    });
+                    auto probe = TrialManager(linears, features, featuresAndDomains, constrainedFeatures); // only sizes the task
+                    probe.setContinuousN(n);
+                    probe.setDistributions(distributions);
+                    probe.setEnumeration(EXACT_ENUMERATION && !COMMON_RANDOM_NUMBERS);
+                    const uint64_t points = probe.gridSize();
+                    const uint64_t samplesPerPoint = COMMON_RANDOM_NUMBERS
+                        ? SAMPLES_PER_POINT
+                        : probe.beginPoint(SAMPLES_PER_POINT); // first point's, enumeration can vary a little across the grid
+                    auto previous = std::shared_ptr<const json>();
+                    if (COARSE_TO_FINE && n > STARTN) {
+                        probe.setContinuousN(n - 1);
+                        const uint64_t coarsePoints = probe.gridSize();
+                        probe.setContinuousN(n);
+                        previous = coarseOutput(probe.getCountingFeatureNames(), n - 1, coarsePoints);
+                    }
+                    const double newShare = previous ? 1.0 - (double) previous->size() / points : 1.0; // of a chunk's points
+                    const uint64_t chunks = (points + GRID_CHUNK_POINTS - 1) / GRID_CHUNK_POINTS;
+                    std::string linNames = "";
+                    for (const auto& lin : probe.getCountingFeatureNames())
+                        linNames += lin + "-";
+                    linNames = linNames.substr(0, linNames.length() - 1);
+                    auto output = std::make_shared<PairOutput>( // shared by the pair's chunks
+                        "../out/working/" + std::to_string(n) + "_" + linNames + "_" + std::to_string(SAMPLES_PER_POINT) + ".json", // working destination
+                        "../out/" + std::to_string(n) + "_" + linNames + "_" + std::to_string(SAMPLES_PER_POINT) + ".json", // final destination
+                        chunks
+                    );
+                    for (uint64_t c = 0; c < chunks; c++) { // grid points [first, last) per task
+                        const uint64_t first = c * GRID_CHUNK_POINTS;
+                        const uint64_t last = std::min(points, first + GRID_CHUNK_POINTS);
+                        plan.push_back(PlannedTask { linears, (uint32_t) n, c, first, last, samplesPerPoint,
+                            (double) (last - first) * newShare * samplesPerPoint * costPerSample, output, previous });
+                    }
                 }
             }
+            if (!COARSE_TO_FINE && n < lastN)
+                continue; // every n goes in one plan
+            // longest processing time first. stable, so equal chunks of a pair stay in grid order and merge as they finish
+            std::stable_sort(plan.begin(), plan.end(), [](const PlannedTask& a, const PlannedTask& b) { return a.cost > b.cost; });
+            for (const auto& task : plan) {
+                std::cout << "\tqueueing task to threadpool" << "\n\tn: " << task.n << " " << task.linears[0] << task.linears[1]
+                    << " chunk: " << task.chunk + 1 << "/" << task.output->chunks << " cost: " << task.cost << std::endl;
+                tp->queueTask([features, featuresAndDomains, constrainedFeatures, distributions, task]() {
+                    const auto started = std::chrono::steady_clock::now();
+                    thread_start(task.linears, features, featuresAndDomains, constrainedFeatures, distributions,
+                        task.n, task.chunk, task.first, task.last, *task.output, task.previous.get());
+                    logTaskTime(task, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+                });
+            }
+            plan.clear();
+            if constexpr (COARSE_TO_FINE) {
+                tp->waitIdle(); // every pair has its output at n before any is refined
+                std::cout << "n: " << n << " complete for every pair." << std::endl;
+                tm.printTimeSinceLastMark();
+            }
         }
         std::cout << "All Tasks Created." << std::endl;
         tm.printTimeSinceLastMark();
-        while (tp->busy()) { std::this_thread::yield(); } // wait till all tasks are allocated to threads
-        delete tp; // await allocated tasks to finish
+        tp->waitIdle(); // sleeps until every chunk is written
+        delete tp;
         std::cout << "all threads complete" << std::endl;
         tm.printTimeSinceLastMark();
         tm.printCurrentTimeAndDate();
         tm.printTimeSinceStart();
         return 1;
     }
+    auto coarseOutput(const std::vector<std::string>& countingNames, uint32_t n, uint64_t points) -> std::shared_ptr<const json> {
+        // pair's finished output at n, if it holds the whole grid. else null, and the next n computes every point
+        std::string linNames = "";
+        for (const auto& lin : countingNames)
+            linNames += lin + "-";
+        linNames = linNames.substr(0, linNames.length() - 1);
+        const std::string fileName = "../out/" + std::to_string(n) + "_" + linNames + "_" + std::to_string(SAMPLES_PER_POINT) + ".json";
+        std::ifstream checkIfExists(fileName);
+        if (!checkIfExists.good())
+            return nullptr;
+        checkIfExists.close();
+        auto coarse = std::make_shared<const json>(JsonUtils::readJsonFile(fileName));
+        if (!coarse->is_array() || coarse->size() != points) {
+            std::cout << "\t" << fileName << " doesn't match its grid, computing every point at n " << n + 1 << std::endl;
+            return nullptr;
+        }
+        return coarse;
+    }
+    auto logTaskTime(const PlannedTask& task, double seconds) -> void { // one csv row per finished task
+        static std::mutex logLock;
+        std::unique_lock<std::mutex> guard(logLock);
+        std::ofstream log(TASK_LOG_PATH, std::ios::app);
+        log << task.n << "," << task.linears[0] << "-" << task.linears[1] << "," << task.chunk << "," << task.last - task.first
+            << "," << task.samplesPerPoint << "," << task.cost << "," << seconds << std::endl;
+    }
     auto allDiscrete(
         const std::vector<std::string>& selected,
         const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>& map
@@ -174,269 +330,229 @@ namespace FullSearch {
         const std::vector<std::string>& features,
         const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>& featuresAndDomains,
         const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>& constrainedFeatures,
-        uint32_t n
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>& distributions,
+        uint32_t n,
+        uint64_t chunk,
+        uint64_t first,
+        uint64_t last,
+        PairOutput& output,
+        const json* previous
     ) -> void {
         std::cout << "starting thread job" << std::endl;
         TrialManager set = TrialManager(linears, features, featuresAndDomains, constrainedFeatures);
-        set.setContinuousN(n);
-        std::mt19937* gen = new std::mt19937(
-            std::chrono::system_clock::now()
-            .time_since_epoch()
-            .count()
-        );
+        configure(set, n, distributions);
+        auto gen = Random::Generator(streamKey(linears, n)); // counter based, grid point i reads stream i of this key
         //std::cout << "size (i, l, r): (" << indexMap.size() << ", " << linearFeatureNames.size() << "," << randomFeatureNames.size() << ")" << std::endl;
-        set.setRandomGen(gen);
-        std::vector<std::string> countingNames = set.getCountingFeatureNames();
-        std::string linNames = "";
-        for (const auto& lin : countingNames)
-            linNames += lin + "-";
-        linNames = linNames.substr(0, linNames.length() - 1);
-
-        const std::string fileName = "../out/working/" + std::to_string(n) + "_" + linNames + "_" + std::to_string(SAMPLES_PER_POINT) + ".json"; // working destination
-        const std::string finalFileName = "../out/" + std::to_string(n) + "_" + linNames + "_" + std::to_string(SAMPLES_PER_POINT) + ".json"; // final destination
-
-        std::cout << "thread: setting up file info" << std::endl;
-
-        std::ifstream checkIfAlreadyExists(fileName); // check if file already exists
-        if (!checkIfAlreadyExists.good()) { // doesn't exist
-            checkIfAlreadyExists.close();
-            std::ofstream initJson(fileName);
-            initJson << "[]" << std::endl;
-            initJson.close(); // guarentee out file exists
-            std::cout << "\tshould have written file: " << fileName << std::endl;
-        }
-        else { // exists, no change required
-            checkIfAlreadyExists.close();
-        }
-
+        set.setRandomGen(&gen);
+        auto buffers = SampleBuffers(model, set);
+        drawCommonSamples(model, set, gen, buffers);
         std::cout << "thread: starting to collect data" << std::endl;
-        auto data = std::vector<std::pair<std::vector<double>, Stats::StatsTracker>>();
-        data.reserve(BATCH_WRITE_SIZE);
-        size_t bufferUsage = 0;
-        bool done = false;
-        while (!done) {
-            if (bufferUsage >= BATCH_WRITE_SIZE) { // only save on passing BATCH_WRITE_SIZE
-                appendToJsonFile(fileName, data); // assume success for now
-                data.clear();
-                bufferUsage = 0;
-            } // done set true when n increment is needed, ie, task done
-            data.push_back(std::pair<std::vector<double>, Stats::StatsTracker>(
-                std::move(std::vector<double>()),
-                std::move(Stats::StatsTracker(STATS_KEYS))
-            )); // initialize elem
-            //std::cout << "thread: iterating" << std::endl;
-            done = iterate(set, data[bufferUsage]);
-            //std::cout << "thread: iterated" << std::endl;
-            bufferUsage++;
+        auto data = std::vector<json>();
+        data.reserve(last - first);
+        auto point = std::pair<std::vector<double>, Stats::StatsTracker>(
+            std::vector<double>(),
+            Stats::StatsTracker(STATS_KEYS)
+        ); // reused by every point of the chunk, iterate resets it
+        set.seekGrid(first); // chunk starts mid walk
+        for (uint64_t gridIndex = first; gridIndex < last; gridIndex++) {
+            if (previous != nullptr && set.isOnCoarseGrid()) { // computed at n - 1 already
+                data.push_back(previous->at(set.getCoarseGridIndex()));
+                set.iterateCountingFeatures();
+                continue;
+            }
+            gen.seek(gridIndex); // point's samples depend only on (RUN_SEED, linears, n, grid index), so chunking can't change them
+            iterate(model, set, point, buffers);
+            data.push_back(toJson(point));
         }
-        appendToJsonFile(fileName, data); // assume success for now // last write
-        data.clear();
-        int code = rename(fileName.c_str(), finalFileName.c_str()); // attempt to move from working to out
-        std::cout << "\t" << linNames << " writing on n change. Write Code: " << std::to_string(code) << std::endl;
+        output.complete(chunk, std::move(data)); // written once every earlier chunk of the pair is
 
         std::cout << "\tthread " << std::this_thread::get_id() << " complete. " << std::endl
-            << "\t\t" << linNames << std::endl;
-
-        delete gen;
+            << "\t\tchunk " << chunk + 1 << "/" << output.chunks << " of " << output.finalFileName << std::endl;
     }
-    auto iterate(TrialManager& set, std::pair<std::vector<double>, Stats::StatsTracker>& outData) -> bool {
-        double runningMean = 0.0;
-        //std::cout << "iterate: starting iteration" << std::endl;
-        for (size_t i = 0; i < SAMPLES_PER_POINT; i++) {
-            set.iterateRandomFeatures(); // generate sample w/ linears static
-            //std::cout << "iterate: iterated randoms" << std::endl;
-            //iterateRandoms(randoms); 
-            //std::cout << "Sample " << i << std::endl;
-            //std::vector<float_t> curr = getCurrs(linears, randoms, indexMap);
-            auto currs = set.getCurrent();
-            //std::cout << "iterate: get currents" << std::endl;
-            auto prediction = getPrediction(currs, outData.second);
-            //std::cout << "iterate: made prediction" << std::endl;
-            //std::cout << "predicted: " << prediction << std::endl;
-            runningMean = Stats::arithmeticMeanStep(i + 1, prediction, runningMean);
+    auto refinePair(
+        ThreadManagement::ThreadPool& tp,
+        const std::vector<std::string>& linears,
+        const std::vector<std::string>& features,
+        const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>& featuresAndDomains,
+        const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>& constrainedFeatures,
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>& distributions
+    ) -> void {
+        // quadtree (one dimension per continuous counting feature) over every slice of the discrete and constrained
+        // ones. all STARTN cells are evaluated at their corners, the ones needsRefinement picks are split in halves
+        // along every continuous feature, down to MAXN. points are indexed on the MAXN grid and read the same streams
+        // as a uniform MAXN run, so every point written is the one that run would write. a pair without continuous
+        // features is its own single level grid, which a uniform run only computes at STARTN, so it reads those streams
+        auto grid = TrialManager(linears, features, featuresAndDomains, constrainedFeatures);
+        grid.setContinuousN(MAXN);
+        const auto places = grid.getContinuousGridPlaces();
+        const uint32_t pointN = places.empty() ? STARTN : MAXN; // grid indexes don't depend on n without continuous features
+        const uint64_t denominator = (uint64_t) 1 << MAXN;
+        const size_t corners = (size_t) 1 << places.size();
+        auto cornerIndex = [&](uint64_t lower, uint64_t step, size_t corner) {
+            for (size_t d = 0; d < places.size(); d++)
+                if (corner >> d & 1)
+                    lower += step * places[d];
+            return lower;
+        };
+
+        auto cells = std::vector<RefineCell>();
+        auto open = std::vector<size_t>(); // cells at the current n, corners still to evaluate
+        const uint64_t rootStep = (uint64_t) 1 << (MAXN - STARTN);
+        for (uint64_t index = 0; index < grid.gridSize(); index++) {
+            bool root = true; // every numerator a multiple of rootStep, with room for a whole cell above it
+            for (const auto& place : places) {
+                const uint64_t numerator = index / place % (denominator + 1);
+                root = root && numerator % rootStep == 0 && numerator < denominator;
+            }
+            if (root) {
+                open.push_back(cells.size());
+                cells.push_back(RefineCell { STARTN, index, {} });
+            }
         }
 
-        outData.first = std::vector<double>();
-        for (const auto& variant : set.getCountingCurrent()) {
-            if (std::holds_alternative<double>(variant)) {
-                double val = std::get<double>(variant);
-                outData.first.push_back(val);
+        auto points = std::map<uint64_t, json>(); // by MAXN grid index
+        for (uint32_t n = STARTN; !open.empty(); n++) {
+            const uint64_t step = (uint64_t) 1 << (MAXN - n);
+            auto missing = std::vector<uint64_t>();
+            for (const auto& c : open)
+                for (size_t corner = 0; corner < corners; corner++)
+                    if (const uint64_t index = cornerIndex(cells[c].lower, step, corner); points.find(index) == points.end())
+                        missing.push_back(index);
+            std::sort(missing.begin(), missing.end());
+            missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+            auto results = std::vector<std::vector<json>>((missing.size() + GRID_CHUNK_POINTS - 1) / GRID_CHUNK_POINTS);
+            ThreadManagement::TaskGroup evaluations(tp); // waiting helps with nested tasks only, never another pair's refinePair
+            for (size_t r = 0; r < results.size(); r++) {
+                evaluations.run([&, r]() {
+                    const size_t first = r * GRID_CHUNK_POINTS;
+                    results[r] = evaluatePoints(linears, features, featuresAndDomains, constrainedFeatures, distributions, pointN,
+                        missing.data() + first, std::min<size_t>(GRID_CHUNK_POINTS, missing.size() - first));
+                });
             }
-            else if (std::holds_alternative<int64_t>(variant)) {
-                int64_t val = std::get<int64_t>(variant);
-                outData.first.push_back(val);
+            evaluations.wait();
+            for (size_t i = 0; i < missing.size(); i++)
+                points.emplace(missing[i], std::move(results[i / GRID_CHUNK_POINTS][i % GRID_CHUNK_POINTS]));
+            std::cout << "\t" << linears[0] << linears[1] << " n: " << n << " cells: " << open.size()
+                << " new points: " << missing.size() << std::endl;
+
+            auto next = std::vector<size_t>();
+            if (n < MAXN && !places.empty()) {
+                for (const auto& c : open) {
+                    auto values = std::vector<const json*>();
+                    for (size_t corner = 0; corner < corners; corner++)
+                        values.push_back(&points.at(cornerIndex(cells[c].lower, step, corner)));
+                    if (!needsRefinement(values))
+                        continue;
+                    for (size_t corner = 0; corner < corners; corner++) { // child per corner, sharing this cell's center
+                        cells[c].children.push_back(cells.size());
+                        next.push_back(cells.size());
+                        cells.push_back(RefineCell { n + 1, cornerIndex(cells[c].lower, step / 2, corner), {} });
+                    }
+                }
             }
-            else {
-                std::cout << "ERROR:: MAP KEY FAILURE";
-                throw std::exception();
+            open = std::move(next);
+        }
+
+        std::string linNames = "";
+        for (const auto& lin : grid.getCountingFeatureNames())
+            linNames += lin + "-";
+        linNames = linNames.substr(0, linNames.length() - 1);
+        const std::string name = "../out/" + std::to_string(STARTN) + "-" + std::to_string(MAXN) + "_" + linNames + "_" + std::to_string(SAMPLES_PER_POINT);
+
+        json pointData = JsonUtils::JsonArray; // sparse, in grid order
+        for (const auto& [index, point] : points)
+            pointData.emplace_back(point);
+        JsonUtils::writeJsonFile(name + "_adaptive.json", pointData);
+        json cellData = JsonUtils::JsonArray; // STARTN cells first, children point into this array
+        for (const auto& cell : cells) {
+            json cellObj = JsonUtils::JsonObject;
+            const uint64_t step = (uint64_t) 1 << (MAXN - cell.n);
+            cellObj["n"] = cell.n;
+            cellObj["lower"] = points.at(cell.lower)["coords"];
+            cellObj["upper"] = points.at(cornerIndex(cell.lower, step, corners - 1))["coords"];
+            cellObj["children"] = cell.children;
+            cellData.emplace_back(cellObj);
+        }
+        JsonUtils::writeJsonFile(name + "_cells.json", cellData);
+        std::cout << "\t" << name << " complete. points: " << points.size() << " of " << grid.gridSize()
+            << ", cells: " << cells.size() << std::endl;
+    }
+    auto evaluatePoints(
+        const std::vector<std::string>& linears,
+        const std::vector<std::string>& features,
+        const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>& featuresAndDomains,
+        const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>& constrainedFeatures,
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>& distributions,
+        uint32_t n,
+        const uint64_t* indexes,
+        size_t count
+    ) -> std::vector<json> { // n grid points at indexes, in that order
+        TrialManager set = TrialManager(linears, features, featuresAndDomains, constrainedFeatures);
+        configure(set, n, distributions);
+        auto gen = Random::Generator(streamKey(linears, n));
+        set.setRandomGen(&gen);
+        auto buffers = SampleBuffers(model, set);
+        drawCommonSamples(model, set, gen, buffers);
+        auto data = std::vector<json>();
+        data.reserve(count);
+        auto point = std::pair<std::vector<double>, Stats::StatsTracker>(
+            std::vector<double>(),
+            Stats::StatsTracker(STATS_KEYS)
+        );
+        for (size_t i = 0; i < count; i++) {
+            set.seekGrid(indexes[i]);
+            gen.seek(indexes[i]);
+            iterate(model, set, point, buffers);
+            data.push_back(toJson(point));
+        }
+        return data;
+    }
+    auto needsRefinement(const std::vector<const json*>& corners) -> bool {
+        // corners disagree on a mean or tally percentage, or (with a finite REFINE_STD_DEV) one of them is noisy on its own
+        for (const auto& k : STATS_KEYS) {
+            double lowMean = DBL_MAX, highMean = -DBL_MAX, lowTally = DBL_MAX, highTally = -DBL_MAX;
+            for (const auto* corner : corners) {
+                const auto& v = (*corner)["v"][k];
+                if (std::sqrt(std::max(v["sv"].get<double>(), 0.0)) > REFINE_STD_DEV)
+                    return true;
+                lowMean = std::min(lowMean, v["m"].get<double>());
+                highMean = std::max(highMean, v["m"].get<double>());
+                lowTally = std::min(lowTally, v["tp"].get<double>());
+                highTally = std::max(highTally, v["tp"].get<double>());
             }
+            if (highMean - lowMean > REFINE_DELTA || highTally - lowTally > REFINE_DELTA)
+                return true;
         }
-        //outData.second = runningMean;
-        //std::cout << "iterate: iterating coutings" << std::endl;
-        return set.iterateCountingFeatures();
+        return false;
+    }
+    auto configure(
+        TrialManager& set,
+        uint32_t n,
+        const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>& distributions
+    ) -> void { // sampling setup shared by every kind of task
+        set.setContinuousN(n);
+        set.setDistributions(distributions);
+        set.setSamplingMode(SAMPLING);
+        set.setEnumeration(EXACT_ENUMERATION && !COMMON_RANDOM_NUMBERS);
+        set.setCommonRandomNumbers(COMMON_RANDOM_NUMBERS);
+    }
+    auto streamKey(const std::vector<std::string>& linears, uint32_t n) -> uint64_t {
+        uint64_t key = Random::mix(RUN_SEED, n);
+        for (const auto& lin : linears)
+            key = Random::mix(key, lin);
+        return key;
     }
-    auto appendToJsonFile(const std::string& fileName, const std::vector<std::pair<std::vector<double>, Stats::StatsTracker>>& dataToAppend) -> bool {
+    auto appendToJsonFile(const std::string& fileName, const std::vector<json>& dataToAppend) -> bool {
         std::ifstream i(fileName);
         json oldData = json::parse(i);
         i.close();
-        for (const auto& outData : dataToAppend) {
-            json dataObj = JsonUtils::JsonObject;
-            dataObj["coords"] = outData.first;
-            dataObj["v"] = JsonUtils::JsonObject;
-            for (const auto k : STATS_KEYS) {
-                dataObj["v"][k] = JsonUtils::JsonObject;
-                dataObj["v"][k]["m"] = outData.second.getMean(k);
-                dataObj["v"][k]["sv"] = outData.second.getSampleVariance(k);
-                dataObj["v"][k]["tp"] = outData.second.getTallyPercentage(k);
-                dataObj["v"][k]["tc"] = outData.second.getTallyCount(k);
-                dataObj["v"][k]["n"] = outData.second.getN(k);
-            }
+        for (const auto& dataObj : dataToAppend)
             oldData.emplace_back(dataObj);
-        }
         //oldData.merge_patch(dataToAppend); // merge 2 jsons (should have not overwritting keys)
         std::ofstream o(fileName); // if there are overwritten keys, then value should be the same
         o << oldData << std::endl;
         o.close();
         return true;
     }
-    auto getPrediction(std::vector<std::variant<double, int64_t>>& inputValues, Stats::StatsTracker& tracker) -> double {
-        static double pastPred = 0;
-        static uint64_t predCount = 0;
-        static double avgPastPred = 0;
-        static double avgPred = 0;
-        // above is used for debugging, but not used for normal predictions
-        auto alignedInput = fdeep::float_vec();
-        alignedInput.reserve(inputValues.size());
-        for (const auto& i : inputValues) {
-            alignedInput.push_back(
-                (float)(std::holds_alternative<double>(i)
-                    ? std::get<double>(i)
-                    : (std::holds_alternative<int64_t>(i)
-                        ? std::get<int64_t>(i)
-                        : -1.0
-                    )
-                )
-            );
-        }
-        const auto sharedAlignedInput = fplus::make_shared_ref<fdeep::float_vec>(alignedInput);
-        const auto tensorInput = fdeep::tensor(fdeep::tensor_shape(sharedAlignedInput->size()), sharedAlignedInput);
-        auto result = model.predict({tensorInput});
-        std::vector<float> res = result.at(0).to_vector(); // model outputs 2 proabilities [repair, not repair]. Sum is 1.0
-        const float repairProbability = res.at(0); // only care about repair (positive) probability
-
-        //std::cout << "res: ";
-        //for (size_t i = 0; i < res.size(); i++) {
-        //    std::cout << std::to_string(res.at(i)) << ", ";
-        //}
-        //std::cout << std::endl;
-
-        if constexpr (PREDICTION_DEBUG) {
-            avgPred = Stats::arithmeticMeanStep(++predCount, repairProbability, avgPred);
-            avgPastPred = Stats::arithmeticMeanStep(predCount, std::abs(repairProbability - pastPred), avgPastPred);
-            if (predCount % (SAMPLES_PER_POINT / 2) == 0) {
-                std::cout << "Prediction: ";
-                for (const auto& i : alignedInput) {
-                    std::cout << std::to_string(i) << ", ";
-                }
-                std::cout << std::endl;
-                std::cout << "result: " << std::to_string(repairProbability) << std::endl
-                    << "avg: " << std::to_string(avgPred) << std::endl 
-                    << "diffFromLast: " << std::to_string(repairProbability - pastPred) << std::endl
-                    << "avgDiff: " << std::to_string(avgPastPred) << std::endl
-                    << "predictions so far: " << std::to_string(predCount) << std::endl;
-            }
-            pastPred = repairProbability;
-        }
-        
-        // Decoding Stage
-        const auto resSize = res.size();
-        for (auto i = 0; i < resSize; i++) {
-            if constexpr (ROUND_PREDICTION_RESULTS) {
-                res[i] = (uint64_t) (res[i] + 0.5f);
-            }
-            else if constexpr (TEMP_DECODING_STAGE) {
-                if (i == 0)
-                    res[i] = res[i] >= 0.9 ? 1.0 : 0.0;
-                else // i == 1
-                    res[i] = res[i] > 0.1 ? 1.0 : 0.0;
-            }
-            else if constexpr (TEMP_DECODING_STAGE_2) {
-                if (i == 0)
-                    res[i] = res[i] >= 0.9f
-                        ? ((res[i] - 0.9f) * 5.0f) + 0.5f // 0.9-1 -> 0-0.1 -> 0-0.5 -> 0.5-1
-                        : (res[i] / 9.0f) * 5.0f; // 0-0.9 -> 0-0.1 -> 0-0.5
-                else // i == 1
-                    res[i] = res[i] > 0.1f
-                        ? (((res[i] - 0.1f) / 9.0f) * 5.0f) + 0.5f // 0.1-1 -> 0-0.9 -> 0-0.1 -> 0-0.5 -> 0.5-1
-                        : res[i] * 5.0f; // 0-0.1 -> 0-0.5
-            }
-            else { // this else needed explicitly cause its part of constexpr.
-                // res[i] = res[i];
-            }
-        }
-
-        if constexpr (IRIS_MODEL) {
-            auto setosa = res.at(0);
-            auto versi = res.at(1);
-            auto virgi = res.at(2);
-            tracker.addNewValue("setosa", setosa);
-            tracker.addNewValue("versicolor", versi);
-            tracker.addNewValue("virginica", virgi);
-            if (setosa >= versi && setosa >= virgi)
-                tracker.addTally("setosa");
-            else if (versi >= setosa && versi >= virgi)
-                tracker.addTally("versicolor");
-            else if (virgi >= setosa && virgi >= versi)
-                tracker.addTally("virginica");
-        }
-        else if constexpr (NBI_MODEL) {
-            auto repair = res.at(0);
-            auto nRepair = res.at(1);
-            tracker.addNewValue("repair", repair);
-            tracker.addNewValue("not_repair", nRepair);
-            if (repair > nRepair)
-                tracker.addTally("repair");
-            else
-                tracker.addTally("not_repair");
-        }
-        else if constexpr (WINE_MODEL) {
-            auto quality = res.at(0);
-            tracker.addNewValue("quality", quality);
-        }
-
-        return 0; // currently unused
-        // auto input = std::vector<double>();
-        // input.reserve(inputValues.size());
-        // for (const auto& i : inputValues) {
-        //     double v = (double)(std::holds_alternative<double>(i)
-        //         ? std::get<double>(i)
-        //         : (std::holds_alternative<int64_t>(i)
-        //             ? std::get<int64_t>(i)
-        //             : -1.0)
-        //     );
-        //     input.push_back(v);
-        // }
-        // double mean = Stats::arithmeticMean(input);
-
-        // auto alignedInput = fdeep::float_vec();
-        // alignedInput.reserve(input.size());
-        // for (const auto& i : input)
-        //     alignedInput.push_back(i);
-        // auto sharedAlignedInput = fplus::make_shared_ref<fdeep::float_vec>(alignedInput);
-        // auto tensorInput = fdeep::tensor(fdeep::tensor_shape(sharedAlignedInput->size()), sharedAlignedInput);
-        // std::cout << fdeep::show_tensor(tensorInput) << std::endl;
-        // std::cout << fdeep::show_tensor_shape(tensorInput.shape()) << std::endl;
-        // const auto result = model.predict({tensorInput});
-        // std::cout << fdeep::show_tensor_shape(result.front().shape()) << std::endl;
-        // std::cout << fdeep::show_tensors(result) << std::endl;
-        // const fdeep::tensor rez = result.at(0);
-        // std::cout << "rez: " << fdeep::show_tensor(rez) << ", " << rez.get(fdeep::tensor_pos(0)) << ", " << rez.get(fdeep::tensor_pos(1)) << std::endl;
-        // std::vector<float> res = rez.to_vector();
-        // std::cout << "res: ";
-        // for (size_t i = 0; i < res.size(); i++) {
-        //     std::cout << std::to_string(res.at(i)) << ", ";
-        // }
-        // std::cout << std::endl;
-        // return ((int) mean) % 2 == 0; // faker
-    }
 }
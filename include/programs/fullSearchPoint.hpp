@@ -0,0 +1,334 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "TrialManager.hpp"
+#include "RandomGenerator.hpp"
+#include "stats.hpp"
+#include "StatsTracker.hpp"
+#include "JsonUtils.hpp"
+#include "DenseNetwork.hpp"
+#ifdef COMPILED_MODEL // generated at build time from COMPILED_MODEL_JSON, see CMakeLists.txt
+#include "CompiledModel.hpp"
+#endif
+
+// FullSearch's settings and the work of one grid point: sampling, prediction and stats. kept apart from the model,
+// which fullSearch.hpp loads through frugally-deep at startup, so a point runs on anything with Inference::Model's
+// interface (tests drive it with a bare DenseNetwork)
+namespace FullSearch {
+
+    constexpr const uint32_t    SAMPLES_PER_POINT               = 3000;
+    constexpr const uint32_t    SAMPLES_PER_BATCH               = 500; // samples evaluated per model call
+    constexpr const uint32_t    MIN_SAMPLES_PER_POINT           = 500; // adaptive sampling never stops before this
+    constexpr const double      TARGET_HALF_WIDTH               = 0.01; // adaptive sampling stops once every mean and tally proportion is within +-this
+    constexpr const double      CONFIDENCE_Z                    = 1.96; // 95% intervals
+    constexpr const uint32_t    STARTN                          = 7; // min 1
+    constexpr const uint32_t    MAXN                            = 7;
+    constexpr const uint32_t    MAX_NONRUNNING_TASKS            = 16;
+    constexpr const uint64_t    GRID_CHUNK_POINTS               = 2048; // grid points per task, a pair's grid is split across the pool
+    constexpr const uint32_t    MAX_THREADS_IN_THREADPOOL       = 8;
+    constexpr const auto        TASK_LOG_PATH                   = "../out/task_times.csv"; // estimated cost and run time per task
+    constexpr const uint64_t    RUN_SEED                        = 1; // same seed, same results. change for an independent run
+
+    constexpr const bool        PREDICTION_DEBUG                = false;
+    constexpr const bool        ADAPTIVE_SAMPLING               = false; // stop a point between MIN_SAMPLES_PER_POINT and SAMPLES_PER_POINT once converged
+    constexpr const bool        NATIVE_INFERENCE                = true; // dense stacks skip fdeep
+    constexpr const bool        COMMON_RANDOM_NUMBERS           = false; // one sample matrix per task, reused at every grid point
+    constexpr const bool        IMPORTANCE_WEIGHTS              = false; // weight histogram draws back to the uniform domain
+    constexpr const bool        COARSE_TO_FINE                  = false; // each n after STARTN only computes the points n - 1 lacks
+    constexpr const bool        ADAPTIVE_REFINEMENT             = false; // per pair, cells of the STARTN grid are split down to MAXN where the model varies
+    constexpr const double      REFINE_DELTA                    = 0.05; // a cell splits when its corners' means or tally percentages differ by more than this
+    constexpr const double      REFINE_STD_DEV                  = std::numeric_limits<double>::infinity(); // opt in, a cell also splits when a corner's standard deviation is above this. off as most points spread widely
+    constexpr const bool        EXACT_ENUMERATION               = false; // all-discrete random features that fit in SAMPLES_PER_POINT are enumerated, not sampled
+    constexpr const auto        SAMPLING                        = SAMPLING_MODE::MONTE_CARLO; // QUASI_MONTE_CARLO, STRATIFIED or LATIN_HYPERCUBE need fewer SAMPLES_PER_POINT
+
+    constexpr const bool        ROUND_PREDICTION_RESULTS        = false;
+    constexpr const bool        TEMP_DECODING_STAGE             = false;
+    constexpr const bool        TEMP_DECODING_STAGE_2           = false;
+
+    constexpr const bool        IRIS_MODEL                      = false;
+    constexpr const bool        NBI_MODEL                       = true;
+    constexpr const bool        WINE_MODEL                      = false;
+
+    constexpr const auto        MODEL_PATH                      = "../in/saved_model.json";
+    constexpr const auto        FEATURE_DOMAIN_CONSTRAINT_PATH  = "../in/features.json";
+
+    constexpr const bool        VALID                           = STARTN >= 1 && STARTN <= MAXN;
+
+    std::vector<std::string> STATS_KEYS;
+
+    constexpr const size_t      RESIDENT_ROWS                   = COMMON_RANDOM_NUMBERS ? SAMPLES_PER_POINT : SAMPLES_PER_BATCH;
+
+    struct SampleBuffers { // sized once per task so sampling and prediction never touch the heap
+        std::vector<float> inputs; // RESIDENT_ROWS x model inputs
+        std::vector<uint32_t> oneHotActive; // RESIDENT_ROWS x constrained sets
+        std::vector<float> outputs; // SAMPLES_PER_BATCH x model outputs
+        std::vector<float> weights; // RESIDENT_ROWS importance weights
+        std::vector<float> countingInputs;
+        Inference::DenseWorkspace workspace;
+
+        template <typename M>
+        SampleBuffers(const M&, const TrialManager&);
+    };
+
+    auto statsKeys() -> std::vector<std::string>;
+    template <typename M>
+    auto drawCommonSamples(const M&, TrialManager&, Random::Generator&, SampleBuffers&) -> void;
+    template <typename M>
+    auto iterate(const M&, TrialManager&, std::pair<std::vector<double>, Stats::StatsTracker>&, SampleBuffers&) -> bool;
+    auto converged(const Stats::StatsTracker&) -> bool;
+    auto toJson(const std::pair<std::vector<double>, Stats::StatsTracker>&) -> json;
+    template <typename M>
+    auto getPredictions(const M&, SampleBuffers&, size_t, size_t, Stats::StatsTracker&) -> void;
+    auto recordPrediction(const float*, size_t, float*, size_t, Stats::StatsTracker&, double = 1.0) -> double;
+
+    template <typename M>
+    SampleBuffers::SampleBuffers(const M& model, const TrialManager& set)
+        : inputs(RESIDENT_ROWS * set.getFeatureCount())
+        , oneHotActive(RESIDENT_ROWS * set.getOneHotColumns().size())
+        , outputs(SAMPLES_PER_BATCH * model.getOutputSize())
+        , weights(RESIDENT_ROWS, 1.0f)
+        , countingInputs(set.getCountingIndexes().size())
+        , workspace(model.createWorkspace(SAMPLES_PER_BATCH))
+    {
+        this->workspace.fixColumns(set.getCountingIndexes()); // first layer contribution of counting features is reused across samples
+        this->workspace.setOneHotGroups(set.getOneHotColumns()); // constrained sets become one weight row per sample
+    }
+    auto statsKeys() -> std::vector<std::string> { // keys recordPrediction fills for the configured model
+        if constexpr (IRIS_MODEL)
+            return std::vector<std::string> {"setosa", "versicolor", "virginica"};
+        else if constexpr (NBI_MODEL)
+            return std::vector<std::string> {"repair", "not_repair"};
+        else if constexpr (WINE_MODEL)
+            return std::vector<std::string> {"quality"};
+        else
+            return std::vector<std::string>();
+    }
+    template <typename M>
+    auto drawCommonSamples(const M& model, TrialManager& set, Random::Generator& gen, SampleBuffers& buffers) -> void {
+        if constexpr (COMMON_RANDOM_NUMBERS) { // drawn once from stream 0, grid points only refresh the counting columns
+            gen.seek(0);
+            set.beginPoint(SAMPLES_PER_POINT);
+            set.generateSamples(buffers.inputs.data(), SAMPLES_PER_POINT, buffers.oneHotActive.data(),
+                IMPORTANCE_WEIGHTS ? buffers.weights.data() : nullptr);
+            model.cacheVariableRows(buffers.inputs.data(), SAMPLES_PER_POINT, buffers.workspace);
+        }
+    }
+    template <typename M>
+    auto iterate(const M& model, TrialManager& set, std::pair<std::vector<double>, Stats::StatsTracker>& outData, SampleBuffers& buffers) -> bool {
+        // outData is reused from point to point, clearing keeps its storage so a point allocates nothing until toJson
+        outData.first.resize(set.getCountingIndexes().size());
+        set.getCountingCurrent(outData.first.data());
+        outData.second.reset();
+        const uint64_t samples = COMMON_RANDOM_NUMBERS
+            ? SAMPLES_PER_POINT
+            : set.beginPoint(SAMPLES_PER_POINT); // fewer when the random features are enumerated
+        const size_t width = set.getFeatureCount();
+        const size_t groups = set.getOneHotColumns().size();
+        set.getCountingCurrent(buffers.countingInputs.data());
+        buffers.workspace.setFixedInputs(buffers.countingInputs.data()); // counting features hold still for the whole point
+
+        //std::cout << "iterate: starting iteration" << std::endl;
+        for (size_t start = 0; start < samples; start += SAMPLES_PER_BATCH) {
+            const size_t rows = std::min<size_t>(SAMPLES_PER_BATCH, samples - start);
+            if constexpr (COMMON_RANDOM_NUMBERS) { // same samples as every other point, moved to this one
+                set.refreshSamples(buffers.inputs.data() + start * width, start, rows, buffers.oneHotActive.data() + start * groups);
+                getPredictions(model, buffers, start, rows, outData.second);
+            }
+            else {
+                set.generateSamples(buffers.inputs.data(), rows, buffers.oneHotActive.data(),
+                    IMPORTANCE_WEIGHTS ? buffers.weights.data() : nullptr); // whole batch of samples w/ linears static
+                getPredictions(model, buffers, 0, rows, outData.second); // whole batch evaluated together
+            }
+            if constexpr (ADAPTIVE_SAMPLING) {
+                if (!set.isEnumerating() && start + rows >= MIN_SAMPLES_PER_POINT && converged(outData.second))
+                    break; // flat enough here, n per key in the output records where it stopped
+            }
+        }
+        //outData.second = runningMean;
+        //std::cout << "iterate: iterating coutings" << std::endl;
+        return set.iterateCountingFeatures();
+    }
+    auto converged(const Stats::StatsTracker& tracker) -> bool {
+        for (const auto& k : STATS_KEYS)
+            if (tracker.getMeanHalfWidth(k, CONFIDENCE_Z) > TARGET_HALF_WIDTH
+                || tracker.getTallyHalfWidth(k, CONFIDENCE_Z) > TARGET_HALF_WIDTH)
+                return false;
+        return true;
+    }
+    auto toJson(const std::pair<std::vector<double>, Stats::StatsTracker>& outData) -> json {
+        json dataObj = JsonUtils::JsonObject;
+        dataObj["coords"] = outData.first;
+        dataObj["v"] = JsonUtils::JsonObject;
+        for (const auto& k : STATS_KEYS) {
+            dataObj["v"][k] = JsonUtils::JsonObject;
+            dataObj["v"][k]["m"] = outData.second.getMean(k);
+            dataObj["v"][k]["sv"] = outData.second.getSampleVariance(k);
+            dataObj["v"][k]["tp"] = outData.second.getTallyPercentage(k);
+            dataObj["v"][k]["tc"] = outData.second.getTallyCount(k);
+            dataObj["v"][k]["n"] = outData.second.getN(k);
+        }
+        return dataObj;
+    }
+    template <typename M>
+    auto getPredictions(const M& model, SampleBuffers& buffers, size_t firstRow, size_t rows, Stats::StatsTracker& tracker) -> void {
+        // rows samples of buffers.inputs, from firstRow on
+        const size_t width = model.getInputSize();
+        const size_t outWidth = model.getOutputSize();
+        const float* inputs = buffers.inputs.data() + firstRow * width;
+        #ifdef COMPILED_MODEL
+        CompiledModel::Network::predictBatch(inputs, rows, buffers.outputs.data());
+        #else
+        const uint32_t* oneHotActive = buffers.oneHotActive.data() + firstRow * (buffers.oneHotActive.size() / RESIDENT_ROWS);
+        if constexpr (COMMON_RANDOM_NUMBERS)
+            model.predictCached(inputs, oneHotActive, firstRow, rows, buffers.outputs.data(), buffers.workspace);
+        else
+            model.predictBatch(inputs, oneHotActive, rows, buffers.outputs.data(), buffers.workspace);
+        #endif
+        for (size_t r = 0; r < rows; r++) // NBI model outputs 2 proabilities [repair, not repair]. Sum is 1.0
+            recordPrediction(inputs + r * width, width, buffers.outputs.data() + r * outWidth, outWidth, tracker, buffers.weights[firstRow + r]);
+    }
+    auto recordPrediction(const float* input, size_t inputLen, float* res, size_t resSize, Stats::StatsTracker& tracker, double weight) -> double {
+        static double pastPred = 0;
+        static uint64_t predCount = 0;
+        static double avgPastPred = 0;
+        static double avgPred = 0;
+        // above is used for debugging, but not used for normal predictions
+        const float repairProbability = res[0]; // only care about repair (positive) probability
+
+        //std::cout << "res: ";
+        //for (size_t i = 0; i < res.size(); i++) {
+        //    std::cout << std::to_string(res.at(i)) << ", ";
+        //}
+        //std::cout << std::endl;
+
+        if constexpr (PREDICTION_DEBUG) {
+            avgPred = Stats::arithmeticMeanStep(++predCount, repairProbability, avgPred);
+            avgPastPred = Stats::arithmeticMeanStep(predCount, std::abs(repairProbability - pastPred), avgPastPred);
+            if (predCount % (SAMPLES_PER_POINT / 2) == 0) {
+                std::cout << "Prediction: ";
+                for (size_t i = 0; i < inputLen; i++) {
+                    std::cout << std::to_string(input[i]) << ", ";
+                }
+                std::cout << std::endl;
+                std::cout << "result: " << std::to_string(repairProbability) << std::endl
+                    << "avg: " << std::to_string(avgPred) << std::endl 
+                    << "diffFromLast: " << std::to_string(repairProbability - pastPred) << std::endl
+                    << "avgDiff: " << std::to_string(avgPastPred) << std::endl
+                    << "predictions so far: " << std::to_string(predCount) << std::endl;
+            }
+            pastPred = repairProbability;
+        }
+        
+        // Decoding Stage
+        for (auto i = 0; i < resSize; i++) {
+            if constexpr (ROUND_PREDICTION_RESULTS) {
+                res[i] = (uint64_t) (res[i] + 0.5f);
+            }
+            else if constexpr (TEMP_DECODING_STAGE) {
+                if (i == 0)
+                    res[i] = res[i] >= 0.9 ? 1.0 : 0.0;
+                else // i == 1
+                    res[i] = res[i] > 0.1 ? 1.0 : 0.0;
+            }
+            else if constexpr (TEMP_DECODING_STAGE_2) {
+                if (i == 0)
+                    res[i] = res[i] >= 0.9f
+                        ? ((res[i] - 0.9f) * 5.0f) + 0.5f // 0.9-1 -> 0-0.1 -> 0-0.5 -> 0.5-1
+                        : (res[i] / 9.0f) * 5.0f; // 0-0.9 -> 0-0.1 -> 0-0.5
+                else // i == 1
+                    res[i] = res[i] > 0.1f
+                        ? (((res[i] - 0.1f) / 9.0f) * 5.0f) + 0.5f // 0.1-1 -> 0-0.9 -> 0-0.1 -> 0-0.5 -> 0.5-1
+                        : res[i] * 5.0f; // 0-0.1 -> 0-0.5
+            }
+            else { // this else needed explicitly cause its part of constexpr.
+                // res[i] = res[i];
+            }
+        }
+
+        const auto record = [&](const std::string& key, float value) { // weight stays 1 without IMPORTANCE_WEIGHTS
+            if constexpr (IMPORTANCE_WEIGHTS)
+                tracker.addWeightedValue(key, value, weight);
+            else
+                tracker.addNewValue(key, value);
+        };
+        const auto tally = [&](const std::string& key) {
+            if constexpr (IMPORTANCE_WEIGHTS)
+                tracker.addTally(key, weight);
+            else
+                tracker.addTally(key);
+        };
+        if constexpr (IRIS_MODEL) {
+            auto setosa = res[0];
+            auto versi = res[1];
+            auto virgi = res[2];
+            record("setosa", setosa);
+            record("versicolor", versi);
+            record("virginica", virgi);
+            if (setosa >= versi && setosa >= virgi)
+                tally("setosa");
+            else if (versi >= setosa && versi >= virgi)
+                tally("versicolor");
+            else if (virgi >= setosa && virgi >= versi)
+                tally("virginica");
+        }
+        else if constexpr (NBI_MODEL) {
+            auto repair = res[0];
+            auto nRepair = res[1];
+            record("repair", repair);
+            record("not_repair", nRepair);
+            if (repair > nRepair)
+                tally("repair");
+            else
+                tally("not_repair");
+        }
+        else if constexpr (WINE_MODEL) {
+            auto quality = res[0];
+            record("quality", quality);
+        }
+
+        return 0; // currently unused
+        // auto input = std::vector<double>();
+        // input.reserve(inputValues.size());
+        // for (const auto& i : inputValues) {
+        //     double v = (double)(std::holds_alternative<double>(i)
+        //         ? std::get<double>(i)
+        //         : (std::holds_alternative<int64_t>(i)
+        //             ? std::get<int64_t>(i)
+        //             : -1.0)
+        //     );
+        //     input.push_back(v);
+        // }
+        // double mean = Stats::arithmeticMean(input);
+
+        // auto alignedInput = fdeep::float_vec();
+        // alignedInput.reserve(input.size());
+        // for (const auto& i : input)
+        //     alignedInput.push_back(i);
+        // auto sharedAlignedInput = fplus::make_shared_ref<fdeep::float_vec>(alignedInput);
+        // auto tensorInput = fdeep::tensor(fdeep::tensor_shape(sharedAlignedInput->size()), sharedAlignedInput);
+        // std::cout << fdeep::show_tensor(tensorInput) << std::endl;
+        // std::cout << fdeep::show_tensor_shape(tensorInput.shape()) << std::endl;
+        // const auto result = model.predict({tensorInput});
+        // std::cout << fdeep::show_tensor_shape(result.front().shape()) << std::endl;
+        // std::cout << fdeep::show_tensors(result) << std::endl;
+        // const fdeep::tensor rez = result.at(0);
+        // std::cout << "rez: " << fdeep::show_tensor(rez) << ", " << rez.get(fdeep::tensor_pos(0)) << ", " << rez.get(fdeep::tensor_pos(1)) << std::endl;
+        // std::vector<float> res = rez.to_vector();
+        // std::cout << "res: ";
+        // for (size_t i = 0; i < res.size(); i++) {
+        //     std::cout << std::to_string(res.at(i)) << ", ";
+        // }
+        // std::cout << std::endl;
+        // return ((int) mean) % 2 == 0; // faker
+    }
+}
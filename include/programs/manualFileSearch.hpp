@@ -4,6 +4,7 @@
 
 #include "JsonUtils.hpp"
 #include "TerminalUtils.hpp"
+#include "Model.hpp"
 
 namespace ManualFileSearch {
 
@@ -11,7 +12,7 @@ namespace ManualFileSearch {
     constexpr const auto OUTPUT_FILE_PATH = "../out/output_file_wine.json";
     constexpr const auto MODEL_PATH = "../in/wineModel.json";
 
-    const auto model = fdeep::load_model(MODEL_PATH); // load model once
+    const auto model = Inference::Model(MODEL_PATH); // load model once
 
     auto program() -> int;
     auto readInputFile() -> json;
@@ -52,15 +53,6 @@ namespace ManualFileSearch {
         return JsonUtils::writeJsonFile(OUTPUT_FILE_PATH, j);
     }
     auto getPrediction(const std::vector<float>& inputs) -> std::vector<float> {
-        const auto len = inputs.size();
-        auto alignedInput = fdeep::float_vec();
-        alignedInput.reserve(len);
-        for (auto i = 0; i < len; i++)
-            alignedInput.push_back(inputs.at(i));
-        const auto sharedAlignedInput = fplus::make_shared_ref<fdeep::float_vec>(alignedInput);
-        const auto tensorInput = fdeep::tensor(fdeep::tensor_shape(sharedAlignedInput->size()), sharedAlignedInput);
-        auto result = model.predict({tensorInput});
-        std::vector<float> res = result.at(0).to_vector();
-        return res;
+        return model.predict(inputs);
     }
 }
@@ -10,13 +10,14 @@
 
 #include "JsonUtils.hpp"
 #include "TerminalUtils.hpp"
+#include "Model.hpp"
 
 namespace ManualUserSearch {
 
     constexpr const auto FEATURE_DOMAIN_CONSTRAINT_PATH = "../in/features_iris.json";
     constexpr const auto MODEL_PATH = "../in/saved_model_iris.json";
 
-    const auto model = fdeep::load_model(MODEL_PATH); // load model once
+    const auto model = Inference::Model(MODEL_PATH); // load model once
 
     auto program() -> int;
     auto getFeaturesAndDomainsFromInput(const json&) -> const std::unordered_map<std::string, Domain<double>>;
@@ -70,15 +71,6 @@ namespace ManualUserSearch {
         std::cout << "\tMin-Max: " << d.getMin() << "-" << d.getMax() << std::endl;
     }
     auto getPrediction(const std::vector<float>& inputs) -> std::vector<float> {
-        const auto len = inputs.size();
-        auto alignedInput = fdeep::float_vec();
-        alignedInput.reserve(len);
-        for (auto i = 0; i < len; i++)
-            alignedInput.push_back(inputs.at(i));
-        const auto sharedAlignedInput = fplus::make_shared_ref<fdeep::float_vec>(alignedInput);
-        const auto tensorInput = fdeep::tensor(fdeep::tensor_shape(sharedAlignedInput->size()), sharedAlignedInput);
-        auto result = model.predict({tensorInput});
-        std::vector<float> res = result.at(0).to_vector();
-        return res;
+        return model.predict(inputs);
     }
 }
@@ -1,14 +1,22 @@
 #pragma once
 
+#include <bit>
+#include <cstring>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <random>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #include "ByteSizedIntegral.hpp"
 
 template <Concepts::ByteSizedIntegral I>
 class DynamicBitSet {
+    using Word = std::make_unsigned_t<I>; // bit tricks on the storage type need it unsigned
     std::vector<I> bitCollections;
     constexpr static uint8_t storageContainerBitLen = sizeof(I) * 8;
     constexpr static I oneOfTypeI = 1;
@@ -17,18 +25,39 @@ class DynamicBitSet {
     uint32_t maxIndex;
     uint8_t maxInnerIndex; // if max storage type == 80, so no underflow problem
     bool isEmpty;
+
+    auto tailMask() const -> Word;
+    auto clearTail() -> void;
+    auto requireSameSize(const DynamicBitSet&) const -> void;
 public:
+    constexpr static uint32_t NPOS = -1; // find results when no bit is set
+
     DynamicBitSet();
     DynamicBitSet(uint32_t);
     auto setSize(uint32_t) -> bool;
     auto get(uint32_t) const -> bool;
     auto set(uint32_t, bool) -> bool;
-    auto popcount() -> uint32_t;
+    auto popcount() const -> uint32_t;
     auto operator[](uint32_t) -> bool;
     auto operator[](uint32_t) const -> const bool;
     auto size() const -> uint32_t;
     auto clear() -> void;
     auto setAll() -> void;
+    // unchecked accessors for hot loops, index must be below size()
+    auto getUnchecked(uint32_t) const -> bool;
+    auto setUnchecked(uint32_t, bool) -> void;
+    auto any() const -> bool;
+    auto findFirst() const -> uint32_t;
+    auto findNext(uint32_t) const -> uint32_t;
+    template <typename F>
+    auto forEachSet(F) const -> void;
+    auto expandTo(float*) const -> void;
+    auto operator&=(const DynamicBitSet&) -> DynamicBitSet&;
+    auto operator|=(const DynamicBitSet&) -> DynamicBitSet&;
+    auto operator^=(const DynamicBitSet&) -> DynamicBitSet&;
+    auto operator&(const DynamicBitSet&) const -> DynamicBitSet;
+    auto operator|(const DynamicBitSet&) const -> DynamicBitSet;
+    auto operator^(const DynamicBitSet&) const -> DynamicBitSet;
 };
 template <Concepts::ByteSizedIntegral I>
 DynamicBitSet<I>::DynamicBitSet() {
@@ -63,6 +92,7 @@ auto DynamicBitSet<I>::setSize(uint32_t nSize) -> bool {
     this->maxInnerIndex = isExact
         ? storageContainerBitLen - 1
         : mod - 1;
+    this->clearTail(); // shrinking can't leave bits behind past the end
     return true;
 }
 template <Concepts::ByteSizedIntegral I>
@@ -90,17 +120,10 @@ auto DynamicBitSet<I>::set(uint32_t index, bool value) -> bool {
     return true;
 }
 template <Concepts::ByteSizedIntegral I>
-auto DynamicBitSet<I>::popcount() -> uint32_t {
+auto DynamicBitSet<I>::popcount() const -> uint32_t {
     uint32_t sum = 0;
-    for (const auto& set : bitCollections) {
-        #ifdef __GNUC__
-        sum += __builtin_popcount(set);
-        #else // https://codereview.stackexchange.com/questions/38182/counting-number-of-1s-and-0s-from-integer-with-bitwise-operation
-        uint32_t count;
-        for (count = 0; set != 0; count++, set &= set - 1); // x &= x - 1 removes the rightmost set bit. do this until exhausted
-        sum += count; // 1100 - 1 = 1011, 1100 & 1011 = 1000
-        #endif
-    }
+    for (const auto& set : bitCollections)
+        sum += std::popcount((Word) set); // one instruction per word with hardware popcount
     return sum;
 }
 template <Concepts::ByteSizedIntegral I>
@@ -118,11 +141,127 @@ auto DynamicBitSet<I>::size() const -> uint32_t {
 }
 template <Concepts::ByteSizedIntegral I>
 auto DynamicBitSet<I>::clear() -> void {
-    for (uint32_t i = 0; i < this->bitCollections.size(); i++)
-        this->bitCollections[i] = zeroOfTypeI;
+    if (this->bitCollections.empty()) return;
+    std::memset(this->bitCollections.data(), 0, this->bitCollections.size() * sizeof(I));
 }
 template <Concepts::ByteSizedIntegral I>
 auto DynamicBitSet<I>::setAll() -> void {
-    for (uint32_t i = 0; i < this->bitCollections.size(); i++)
-        this->bitCollections[i] = negOneOfTypeI;
+    if (this->bitCollections.empty()) return;
+    std::memset(this->bitCollections.data(), 0xff, this->bitCollections.size() * sizeof(I));
+    this->clearTail();
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::tailMask() const -> Word { // valid bits of the last word
+    if (this->isEmpty) return 0;
+    return this->maxInnerIndex == storageContainerBitLen - 1
+        ? (Word) negOneOfTypeI
+        : (Word) (((Word) 1 << (this->maxInnerIndex + 1)) - 1);
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::clearTail() -> void { // whole word operations rely on bits past size() staying 0
+    if (this->bitCollections.empty()) return;
+    this->bitCollections.back() = (I) ((Word) this->bitCollections.back() & this->tailMask());
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::requireSameSize(const DynamicBitSet& other) const -> void {
+    if (this->size() != other.size())
+        throw std::invalid_argument("Bitwise operation on dynamic bitsets of sizes "
+            + std::to_string(this->size()) + " and " + std::to_string(other.size()));
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::getUnchecked(uint32_t index) const -> bool {
+    return ((Word) this->bitCollections[index / storageContainerBitLen] >> (index % storageContainerBitLen)) & 1;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::setUnchecked(uint32_t index, bool value) -> void {
+    I& word = this->bitCollections[index / storageContainerBitLen];
+    const Word bit = (Word) 1 << (index % storageContainerBitLen);
+    word = (I) (value ? ((Word) word | bit) : ((Word) word & (Word) ~bit));
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::any() const -> bool {
+    for (const auto& set : this->bitCollections)
+        if (set != zeroOfTypeI) return true;
+    return false;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::findFirst() const -> uint32_t { // lowest set index, NPOS if none
+    for (uint32_t w = 0; w < this->bitCollections.size(); w++)
+        if (this->bitCollections[w] != zeroOfTypeI)
+            return w * storageContainerBitLen + std::countr_zero((Word) this->bitCollections[w]);
+    return NPOS;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::findNext(uint32_t index) const -> uint32_t { // lowest set index above index, NPOS if none
+    uint32_t w = (index + 1) / storageContainerBitLen;
+    const uint32_t inner = (index + 1) % storageContainerBitLen;
+    if (index == NPOS || w >= this->bitCollections.size()) return NPOS;
+    const Word first = (Word) this->bitCollections[w] & (Word) ((Word) negOneOfTypeI << inner);
+    if (first != 0)
+        return w * storageContainerBitLen + std::countr_zero(first);
+    for (w++; w < this->bitCollections.size(); w++)
+        if (this->bitCollections[w] != zeroOfTypeI)
+            return w * storageContainerBitLen + std::countr_zero((Word) this->bitCollections[w]);
+    return NPOS;
+}
+template <Concepts::ByteSizedIntegral I>
+template <typename F>
+auto DynamicBitSet<I>::forEachSet(F visit) const -> void { // visit(index) per set bit, ascending. cost follows the set bits
+    for (uint32_t w = 0; w < this->bitCollections.size(); w++)
+        for (Word bits = (Word) this->bitCollections[w]; bits != 0; bits &= bits - 1) // drops the lowest set bit
+            visit(w * storageContainerBitLen + std::countr_zero(bits));
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::expandTo(float* out) const -> void {
+    // size() floats, 1.0f where set and 0.0f elsewhere. eight bits at a time with avx2
+    const uint32_t len = this->size();
+    uint32_t i = 0;
+    #if defined(__AVX2__)
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= len; i += 8) {
+        const Word word = (Word) this->bitCollections[i / storageContainerBitLen];
+        const int byte = (int) ((word >> (i % storageContainerBitLen)) & 0xff);
+        const __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), lanes), lanes);
+        _mm256_storeu_ps(out + i, _mm256_and_ps(_mm256_castsi256_ps(hit), one));
+    }
+    #endif
+    for (; i < len; i++)
+        out[i] = this->getUnchecked(i) ? 1.0f : 0.0f;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::operator&=(const DynamicBitSet& other) -> DynamicBitSet& {
+    this->requireSameSize(other);
+    for (uint32_t w = 0; w < this->bitCollections.size(); w++)
+        this->bitCollections[w] &= other.bitCollections[w];
+    return *this;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::operator|=(const DynamicBitSet& other) -> DynamicBitSet& {
+    this->requireSameSize(other);
+    for (uint32_t w = 0; w < this->bitCollections.size(); w++)
+        this->bitCollections[w] |= other.bitCollections[w];
+    return *this;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::operator^=(const DynamicBitSet& other) -> DynamicBitSet& {
+    this->requireSameSize(other);
+    for (uint32_t w = 0; w < this->bitCollections.size(); w++)
+        this->bitCollections[w] ^= other.bitCollections[w];
+    return *this;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::operator&(const DynamicBitSet& other) const -> DynamicBitSet {
+    auto result = *this;
+    return result &= other;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::operator|(const DynamicBitSet& other) const -> DynamicBitSet {
+    auto result = *this;
+    return result |= other;
+}
+template <Concepts::ByteSizedIntegral I>
+auto DynamicBitSet<I>::operator^(const DynamicBitSet& other) const -> DynamicBitSet {
+    auto result = *this;
+    return result ^= other;
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Random {
+    // histogram over equal width bins of a feature's domain, e.g. of the data the model was trained on.
+    // random draws use walker's alias method (vose's construction), one table lookup per draw whatever the bin
+    // count. points in [0, 1) from the stratified and quasi random modes go through the cdf instead, so their
+    // spacing carries over to the distribution
+    class EmpiricalDistribution {
+        std::vector<double> probabilities; // normalized weights, per bin
+        std::vector<double> cumulative; // cdf at each bin's upper edge
+        std::vector<uint32_t> threshold; // keep the drawn bin when the low 32 bits fall below this, else take its alias
+        std::vector<uint32_t> alias;
+    public:
+        EmpiricalDistribution(const std::vector<double>&);
+        auto getBins() const -> uint32_t;
+        auto getProbability(uint32_t) const -> double;
+        auto pick(uint32_t) const -> uint32_t;
+        auto fromUniform(double, double&) const -> uint32_t;
+    };
+
+    EmpiricalDistribution::EmpiricalDistribution(const std::vector<double>& weights) {
+        if (weights.empty() || weights.size() > std::numeric_limits<uint32_t>::max())
+            throw std::invalid_argument("EmpiricalDistribution needs between 1 and 2^32 - 1 bins, got "
+                + std::to_string(weights.size()));
+        double total = 0;
+        for (const auto& w : weights) {
+            if (!(w >= 0)) throw std::invalid_argument("EmpiricalDistribution weights can't be negative or NaN");
+            total += w;
+        }
+        if (total <= 0) throw std::invalid_argument("EmpiricalDistribution weights sum to 0");
+        const uint32_t bins = weights.size();
+        this->probabilities = std::vector<double>(bins);
+        this->cumulative = std::vector<double>(bins);
+        double running = 0;
+        for (uint32_t b = 0; b < bins; b++) {
+            this->probabilities[b] = weights[b] / total;
+            running += this->probabilities[b];
+            this->cumulative[b] = running;
+        }
+        this->cumulative.back() = 1.0; // rounding can't leave a gap at the top
+        // vose: bins below the mean are topped up by one bin above it, which gives the remainder back to the pool
+        this->threshold = std::vector<uint32_t>(bins, std::numeric_limits<uint32_t>::max());
+        this->alias = std::vector<uint32_t>(bins);
+        auto scaled = std::vector<double>(bins);
+        auto small = std::vector<uint32_t>();
+        auto large = std::vector<uint32_t>();
+        for (uint32_t b = 0; b < bins; b++) {
+            this->alias[b] = b;
+            scaled[b] = this->probabilities[b] * bins;
+            (scaled[b] < 1.0 ? small : large).push_back(b);
+        }
+        while (!small.empty() && !large.empty()) {
+            const uint32_t s = small.back();
+            const uint32_t l = large.back();
+            small.pop_back();
+            this->threshold[s] = (uint32_t) std::min(scaled[s] * 0x1.0p32, 0x1.0p32 - 1);
+            this->alias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // whatever is left is 1 up to rounding and keeps its own bin
+    }
+    auto EmpiricalDistribution::getBins() const -> uint32_t {
+        return this->probabilities.size();
+    }
+    auto EmpiricalDistribution::getProbability(uint32_t bin) const -> double {
+        return this->probabilities[bin];
+    }
+    auto EmpiricalDistribution::pick(uint32_t bits) const -> uint32_t {
+        // the high part of bits x bins picks a bin uniformly, the low part is an independent coin for its alias
+        const uint64_t product = (uint64_t) bits * this->probabilities.size();
+        const uint32_t bin = (uint32_t) (product >> 32);
+        return (uint32_t) product < this->threshold[bin] ? bin : this->alias[bin];
+    }
+    auto EmpiricalDistribution::fromUniform(double u, double& within) const -> uint32_t {
+        // bin holding the u quantile, within gets u's position inside that bin in [0, 1)
+        const uint32_t bin = std::min<size_t>(
+            std::upper_bound(this->cumulative.begin(), this->cumulative.end(), u) - this->cumulative.begin(),
+            this->cumulative.size() - 1
+        );
+        const double lower = bin == 0 ? 0.0 : this->cumulative[bin - 1];
+        within = this->probabilities[bin] > 0 ? std::clamp((u - lower) / this->probabilities[bin], 0.0, 0x1.fffffffffffffp-1) : 0.0;
+        return bin;
+    }
+}
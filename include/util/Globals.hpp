@@ -4,3 +4,10 @@ enum CONSTRAINT_TYPE {
     ONLYONEHIGHBINARY = 0,
     OTHER = 100
 };
+
+enum SAMPLING_MODE {
+    MONTE_CARLO = 0, // independent uniform draws
+    QUASI_MONTE_CARLO = 1, // scrambled halton points over the random dimensions
+    STRATIFIED = 2, // each random dimension cycles through its strata (categories) in shuffled order
+    LATIN_HYPERCUBE = 3 // each random dimension hits every 1/N slice of its range once per point
+};
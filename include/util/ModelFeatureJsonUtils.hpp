@@ -1,10 +1,12 @@
 #pragma once
 
+#include <memory>
 #include <variant>
 
 #include "Globals.hpp"
 #include "JsonUtils.hpp"
 #include "Domain.hpp"
+#include "EmpiricalDistribution.hpp"
 
 namespace ModelFeatureJsonUtils {
 
@@ -12,6 +14,7 @@ namespace ModelFeatureJsonUtils {
     auto getFeaturesFromInput(const json&) -> const std::vector<std::string>;
     auto getFeaturesAndDomainsFromInput(const json&) -> const std::unordered_map<std::string, std::variant<Domain<double>, Domain<int64_t>>>;
     auto getConstraintedFeaturesFromInput(const json&) -> const std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>;
+    auto getDistributionsFromInput(const json&) -> const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>;
 
     auto readInputFile(std::string featureDomainConstraintPath) -> const json {
         json j = JsonUtils::readJsonFile(featureDomainConstraintPath);
@@ -68,4 +71,20 @@ namespace ModelFeatureJsonUtils {
         return ret;
     }
 
+    auto getDistributionsFromInput(const json& j) -> const std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>> {
+        // optional "histogram" per feature: bin weights over equal width bins of its domain (one per value when
+        // discrete), inline or as the path of a json file holding them
+        auto ret = std::unordered_map<std::string, std::shared_ptr<const Random::EmpiricalDistribution>>();
+        for (auto& f : j["featuresAndDomains"]) {
+            if (!f.contains("histogram")) continue;
+            const json histogram = f["histogram"].is_string()
+                ? JsonUtils::readJsonFile(f["histogram"].get<std::string>())
+                : f["histogram"];
+            ret[f["name"].get<std::string>()] = std::make_shared<const Random::EmpiricalDistribution>(
+                histogram.get<std::vector<double>>()
+            );
+        }
+        return ret;
+    }
+
 };
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RandomGenerator.hpp"
+
+namespace Random {
+    // halton sequence (radical inverse of the sample index in the d-th prime base) with an independent random
+    // permutation of the digits at every position of every dimension. unscrambled halton is strongly correlated
+    // between neighbouring large bases, the permutations break that up and make each point set an unbiased
+    // randomization, so means stay unbiased while their error falls close to 1/N instead of 1/sqrt(N)
+    class ScrambledHalton {
+        static constexpr const double PRECISION = 0x1.0p-32; // digits are taken until they stop mattering
+        uint32_t dimensions;
+        std::vector<uint32_t> bases;
+        std::vector<uint32_t> digitCounts;
+        std::vector<size_t> permutationOffsets; // into permutations, per dimension
+        std::vector<uint32_t> permutations; // per dimension, digitCounts x base
+
+        static auto firstPrimes(uint32_t) -> std::vector<uint32_t>;
+    public:
+        ScrambledHalton();
+        ScrambledHalton(uint32_t);
+        auto getDimensions() const -> uint32_t;
+        auto scramble(Generator&) -> void;
+        auto fill(uint32_t, uint64_t, size_t, float*, size_t) const -> void;
+    };
+
+    auto ScrambledHalton::firstPrimes(uint32_t count) -> std::vector<uint32_t> {
+        auto primes = std::vector<uint32_t>();
+        for (uint32_t candidate = 2; primes.size() < count; candidate++) {
+            bool prime = true;
+            for (const auto& p : primes) {
+                if (p * p > candidate) break;
+                if (candidate % p == 0) {
+                    prime = false;
+                    break;
+                }
+            }
+            if (prime) primes.push_back(candidate);
+        }
+        return primes;
+    }
+    ScrambledHalton::ScrambledHalton() : ScrambledHalton(0) {}
+    ScrambledHalton::ScrambledHalton(uint32_t dims)
+        : dimensions(dims)
+        , bases(firstPrimes(dims))
+    {
+        this->digitCounts = std::vector<uint32_t>(dims);
+        this->permutationOffsets = std::vector<size_t>(dims);
+        size_t total = 0;
+        for (uint32_t d = 0; d < dims; d++) {
+            uint32_t digits = 0;
+            for (double weight = 1.0; weight > PRECISION; weight /= this->bases[d])
+                digits++;
+            this->digitCounts[d] = digits;
+            this->permutationOffsets[d] = total;
+            total += (size_t) digits * this->bases[d];
+        }
+        this->permutations = std::vector<uint32_t>(total);
+        for (uint32_t d = 0; d < dims; d++) // identity until scrambled
+            for (uint32_t j = 0; j < this->digitCounts[d]; j++)
+                for (uint32_t v = 0; v < this->bases[d]; v++)
+                    this->permutations[this->permutationOffsets[d] + (size_t) j * this->bases[d] + v] = v;
+    }
+    auto ScrambledHalton::getDimensions() const -> uint32_t {
+        return this->dimensions;
+    }
+    auto ScrambledHalton::scramble(Generator& gen) -> void { // fisher-yates on every digit position
+        for (uint32_t d = 0; d < this->dimensions; d++) {
+            const uint32_t base = this->bases[d];
+            for (uint32_t j = 0; j < this->digitCounts[d]; j++) {
+                uint32_t* perm = this->permutations.data() + this->permutationOffsets[d] + (size_t) j * base;
+                for (uint32_t v = 0; v < base; v++)
+                    perm[v] = v;
+                for (uint32_t v = base - 1; v > 0; v--)
+                    std::swap(perm[v], perm[gen.uniformIndex(v + 1)]);
+            }
+        }
+    }
+    auto ScrambledHalton::fill(uint32_t dimension, uint64_t firstIndex, size_t count, float* out, size_t stride) const -> void {
+        // points firstIndex.. of one dimension, as floats in [0, 1), stride elements apart
+        const uint32_t base = this->bases[dimension];
+        const uint32_t digits = this->digitCounts[dimension];
+        const uint32_t* perms = this->permutations.data() + this->permutationOffsets[dimension];
+        const double inverseBase = 1.0 / base;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t index = firstIndex + i;
+            double weight = inverseBase;
+            double value = 0.0;
+            for (uint32_t j = 0; j < digits; j++) { // runs past the index's own digits so scrambled zeros count too
+                value += perms[(size_t) j * base + (uint32_t) (index % base)] * weight;
+                index /= base;
+                weight *= inverseBase;
+            }
+            out[i * stride] = std::min((float) value, 0x1.fffffep-1f); // rounding to float can't be allowed to reach 1
+        }
+    }
+}
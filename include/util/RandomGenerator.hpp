@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace Random {
+    constexpr const size_t LANES = 8; // 64 bit outputs produced per engine step
+
+    auto splitmix64(uint64_t&) -> uint64_t;
+    auto mix(uint64_t, uint64_t) -> uint64_t;
+    auto mix(uint64_t, const std::string&) -> uint64_t;
+
+    // uniform draws and bulk fills on top of an engine. Engine provides step(uint64_t* out), writing LANES outputs
+    template <typename Engine>
+    class UniformDraws {
+        uint64_t buffer[LANES]; // last step's outputs, handed out one at a time by operator()
+        size_t used = LANES;
+
+        static auto toUnitFloat(uint32_t) -> float;
+        static auto boundedIndex(uint32_t, uint32_t) -> uint32_t;
+        auto step(uint64_t*) -> void;
+        template <typename T, typename F>
+        auto fill(T*, size_t, size_t, F) -> void;
+    protected:
+        auto discardBuffer() -> void;
+    public:
+        using result_type = uint64_t; // satisfies UniformRandomBitGenerator, so std distributions still work
+        static constexpr auto min() -> result_type { return 0; }
+        static constexpr auto max() -> result_type { return std::numeric_limits<uint64_t>::max(); }
+        auto operator()() -> result_type;
+
+        auto uniformReal(double, double) -> double; // [min, max)
+        auto uniformInt(int64_t, int64_t) -> int64_t; // [min, max]
+        auto uniformIndex(uint32_t) -> uint32_t; // [0, range)
+        // count draws written stride elements apart. floats carry 24 random bits, two per 64 bit output
+        auto fillUniformReal(float*, size_t, size_t, double, double) -> void;
+        auto fillUniformInt(float*, size_t, size_t, int64_t, int64_t) -> void;
+        auto fillUniformIndex(uint32_t*, size_t, size_t, uint32_t) -> void;
+    };
+
+    // Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"). output is a pure function of
+    // (key, counter), so a stream can be jumped to any position: seek(stream) starts block 0 of that stream.
+    // the 128 bit counter is (stream, block), the 64 bit key picks the run
+    class Philox4x32 : public UniformDraws<Philox4x32> {
+        friend class UniformDraws<Philox4x32>;
+        static constexpr const size_t BLOCKS = LANES / 2; // each block gives 4 x 32 bits
+        uint32_t key[2];
+        uint64_t stream;
+        uint64_t block;
+
+        auto step(uint64_t*) -> void;
+    public:
+        Philox4x32(uint64_t, uint64_t = 0);
+        auto seed(uint64_t) -> void;
+        auto seek(uint64_t, uint64_t = 0) -> void;
+        static auto bijection(const uint32_t (&)[4], const uint32_t (&)[2], uint32_t (&)[4]) -> void;
+    };
+
+    using Generator = Philox4x32; // engine used by RandomFeature and the constrained sets
+
+    auto splitmix64(uint64_t& x) -> uint64_t {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    auto mix(uint64_t h, uint64_t v) -> uint64_t { // order dependent 64 bit hash combine, for building keys
+        h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        return splitmix64(h);
+    }
+    auto mix(uint64_t h, const std::string& s) -> uint64_t { // fnv-1a over the bytes, std::hash isn't stable across builds
+        uint64_t f = 0xcbf29ce484222325ull;
+        for (const auto& c : s)
+            f = (f ^ (uint8_t) c) * 0x100000001b3ull;
+        return mix(h, f);
+    }
+
+    template <typename Engine>
+    auto UniformDraws<Engine>::toUnitFloat(uint32_t bits) -> float { // top 24 bits -> [0, 1)
+        return (float) (bits >> 8) * 0x1.0p-24f;
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::boundedIndex(uint32_t bits, uint32_t range) -> uint32_t { // lemire's multiply-shift, bias < range / 2^32
+        return (uint32_t) (((uint64_t) bits * range) >> 32);
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::step(uint64_t* out) -> void {
+        static_cast<Engine*>(this)->step(out);
+    }
+    template <typename Engine>
+    template <typename T, typename F>
+    auto UniformDraws<Engine>::fill(T* out, size_t count, size_t stride, F convert) -> void {
+        // convert maps 32 random bits to a value. whole steps are unrolled, only the tail checks count
+        uint64_t block[LANES];
+        size_t i = 0;
+        for (; i + 2 * LANES <= count; i += 2 * LANES) {
+            this->step(block);
+            for (size_t l = 0; l < LANES; l++) {
+                out[(i + 2 * l) * stride] = convert((uint32_t) (block[l] >> 32));
+                out[(i + 2 * l + 1) * stride] = convert((uint32_t) block[l]);
+            }
+        }
+        if (i < count) {
+            this->step(block);
+            for (size_t l = 0; i < count; l++) {
+                out[i++ * stride] = convert((uint32_t) (block[l] >> 32));
+                if (i < count)
+                    out[i++ * stride] = convert((uint32_t) block[l]);
+            }
+        }
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::discardBuffer() -> void {
+        this->used = LANES;
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::operator()() -> result_type {
+        if (this->used == LANES) {
+            this->step(this->buffer);
+            this->used = 0;
+        }
+        return this->buffer[this->used++];
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::uniformReal(double min, double max) -> double {
+        const double u = (double) ((*this)() >> 11) * 0x1.0p-53; // 53 bits -> [0, 1)
+        return min + u * (max - min);
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::uniformInt(int64_t min, int64_t max) -> int64_t {
+        const uint64_t range = (uint64_t) max - (uint64_t) min + 1; // 0 when the domain spans every int64
+        if (range == 0)
+            return (int64_t) (*this)();
+        if (range <= std::numeric_limits<uint32_t>::max())
+            return min + (int64_t) boundedIndex((uint32_t) ((*this)() >> 32), (uint32_t) range);
+        return min + (int64_t) ((*this)() % range); // huge domains, modulo bias is negligible
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::uniformIndex(uint32_t range) -> uint32_t {
+        return boundedIndex((uint32_t) ((*this)() >> 32), range);
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::fillUniformReal(float* out, size_t count, size_t stride, double min, double max) -> void {
+        const float lo = (float) min;
+        const float span = (float) (max - min);
+        this->fill(out, count, stride, [lo, span](uint32_t bits) -> float { return lo + toUnitFloat(bits) * span; });
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::fillUniformInt(float* out, size_t count, size_t stride, int64_t min, int64_t max) -> void {
+        const uint64_t range = (uint64_t) max - (uint64_t) min + 1;
+        if (range == 0 || range > std::numeric_limits<uint32_t>::max()) { // too wide for a 32 bit draw
+            for (size_t i = 0; i < count; i++)
+                out[i * stride] = (float) this->uniformInt(min, max);
+            return;
+        }
+        this->fill(out, count, stride, [min, range](uint32_t bits) -> float {
+            return (float) (min + (int64_t) boundedIndex(bits, (uint32_t) range));
+        });
+    }
+    template <typename Engine>
+    auto UniformDraws<Engine>::fillUniformIndex(uint32_t* out, size_t count, size_t stride, uint32_t range) -> void {
+        this->fill(out, count, stride, [range](uint32_t bits) -> uint32_t { return boundedIndex(bits, range); });
+    }
+
+    auto Philox4x32::bijection(const uint32_t (&counter)[4], const uint32_t (&k)[2], uint32_t (&out)[4]) -> void {
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        uint32_t k0 = k[0], k1 = k[1];
+        for (int round = 0; round < 10; round++) {
+            const uint64_t p0 = (uint64_t) 0xD2511F53u * c0;
+            const uint64_t p1 = (uint64_t) 0xCD9E8D57u * c2;
+            const uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+            c1 = (uint32_t) p1;
+            c3 = (uint32_t) p0;
+            c0 = n0;
+            c2 = n2;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+    auto Philox4x32::step(uint64_t* out) -> void {
+        // same rounds as bijection over BLOCKS consecutive counters, laid out a word per array so each round vectorizes
+        uint32_t c0[BLOCKS], c1[BLOCKS], c2[BLOCKS], c3[BLOCKS];
+        for (size_t b = 0; b < BLOCKS; b++) {
+            const uint64_t blockIndex = this->block + b;
+            c0[b] = (uint32_t) blockIndex;
+            c1[b] = (uint32_t) (blockIndex >> 32);
+            c2[b] = (uint32_t) this->stream;
+            c3[b] = (uint32_t) (this->stream >> 32);
+        }
+        uint32_t k0 = this->key[0], k1 = this->key[1];
+        for (int round = 0; round < 10; round++) {
+            for (size_t b = 0; b < BLOCKS; b++) {
+                const uint64_t p0 = (uint64_t) 0xD2511F53u * c0[b];
+                const uint64_t p1 = (uint64_t) 0xCD9E8D57u * c2[b];
+                const uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1[b] ^ k0;
+                const uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3[b] ^ k1;
+                c1[b] = (uint32_t) p1;
+                c3[b] = (uint32_t) p0;
+                c0[b] = n0;
+                c2[b] = n2;
+            }
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        this->block += BLOCKS;
+        for (size_t b = 0; b < BLOCKS; b++) {
+            out[2 * b] = ((uint64_t) c1[b] << 32) | c0[b];
+            out[2 * b + 1] = ((uint64_t) c3[b] << 32) | c2[b];
+        }
+    }
+    Philox4x32::Philox4x32(uint64_t k, uint64_t s) {
+        this->seed(k);
+        this->seek(s);
+    }
+    auto Philox4x32::seed(uint64_t k) -> void { // new key, stream 0
+        this->key[0] = (uint32_t) k;
+        this->key[1] = (uint32_t) (k >> 32);
+        this->seek(0);
+    }
+    auto Philox4x32::seek(uint64_t s, uint64_t b) -> void { // draws after this are a function of (key, s, b) only
+        this->stream = s;
+        this->block = b;
+        this->discardBuffer();
+    }
+}
@@ -5,6 +5,7 @@
 #include <map>
 #include <mutex>
 #include <limits>
+#include <cmath>
 
 #include "stats.hpp"
 
@@ -14,34 +15,45 @@ namespace Stats {
             long double mean;
             long double sampleVariance;
             uint64_t n;
-            StatPack() : mean(0), sampleVariance(0), n(0) {};
+            long double weightSum; // n and n for unweighted values
+            long double weightSquareSum;
+            long double weightedM2; // weighted sum of squared deviations, addWeightedValue only
+            StatPack() : mean(0), sampleVariance(0), n(0), weightSum(0), weightSquareSum(0), weightedM2(0) {};
             StatPack(long double m, long double sv, uint64_t n)
-                : mean(m), sampleVariance(sv), n(n) {};
-            StatPack(StatPack& sp)
-                : mean(sp.mean), sampleVariance(sp.sampleVariance), n(sp.n) {};
-            StatPack(const StatPack& sp)
-                : mean(sp.mean), sampleVariance(sp.sampleVariance), n(sp.n) {};
+                : mean(m), sampleVariance(sv), n(n), weightSum(n), weightSquareSum(n), weightedM2(sv * (n > 0 ? n - 1 : 0)) {};
+            StatPack(StatPack& sp) = default;
+            StatPack(const StatPack& sp) = default;
+            auto operator=(const StatPack&) -> StatPack& = default;
         };
     };
     class StatsTracker {
         std::mutex lock;
         std::map<std::string, Internal::StatPack> stats;
         TallyCounter<uint64_t> tallies;
+        std::map<std::string, long double> tallyWeights; // percentages come from these once a weighted tally is added
+        long double tallyWeightTotal;
+        bool weightedTallies;
     public:
         StatsTracker();
         StatsTracker(const std::vector<std::string>&);
         StatsTracker(StatsTracker&&);
 
         auto add(const std::string&) -> bool;
+        auto reset() -> void;
         template <Concepts::Numeric N>
         auto addNewValue(const std::string&, N) -> bool;
+        template <Concepts::Numeric N>
+        auto addWeightedValue(const std::string&, N, double) -> bool;
         auto addTally(const std::string& key) -> bool;
+        auto addTally(const std::string& key, double) -> bool;
 
         auto getTallyCount(const std::string&) const -> uint64_t;
         auto getTallyPercentage(const std::string&) const -> double;
         auto getMean(const std::string&) const -> long double;
         auto getSampleVariance(const std::string&) const -> long double;
         auto getN(const std::string&) const -> uint64_t;
+        auto getMeanHalfWidth(const std::string&, double) const -> double;
+        auto getTallyHalfWidth(const std::string&, double) const -> double;
         
         StatsTracker(StatsTracker&) = delete;
         StatsTracker(const StatsTracker&) = delete;
@@ -50,15 +62,22 @@ namespace Stats {
     StatsTracker::StatsTracker() {
         this->stats = std::map<std::string, Internal::StatPack>();
         this->tallies = TallyCounter<uint64_t>();
+        this->tallyWeightTotal = 0;
+        this->weightedTallies = false;
     }
     StatsTracker::StatsTracker(StatsTracker&& rv) : lock() {
         std::lock_guard m(rv.lock);
-        this->stats = rv.stats;
-        this->tallies = rv.tallies;
+        this->stats = std::move(rv.stats);
+        this->tallies = std::move(rv.tallies);
+        this->tallyWeights = std::move(rv.tallyWeights);
+        this->tallyWeightTotal = rv.tallyWeightTotal;
+        this->weightedTallies = rv.weightedTallies;
     }
     StatsTracker::StatsTracker(const std::vector<std::string>& initKeys) {
         this->stats = std::map<std::string, Internal::StatPack>();
         this->tallies = TallyCounter<uint64_t>();
+        this->tallyWeightTotal = 0;
+        this->weightedTallies = false;
         for (const auto& k : initKeys) {
             this->add(k);
         }
@@ -69,14 +88,27 @@ namespace Stats {
             return false;
         this->stats[key] = Internal::StatPack();
         this->tallies.add(key);
+        this->tallyWeights[key] = 0;
         return true;
     }
+    auto StatsTracker::reset() -> void { // no values recorded, keys kept, so a tracker reused per point never reallocates
+        std::lock_guard m(this->lock);
+        for (auto& [key, sp] : this->stats)
+            sp = Internal::StatPack();
+        this->tallies.reset();
+        for (auto& [key, weight] : this->tallyWeights)
+            weight = 0;
+        this->tallyWeightTotal = 0;
+        this->weightedTallies = false;
+    }
     auto StatsTracker::getTallyCount(const std::string& key) const -> uint64_t {
         if (this->tallies.keyExists(key))
             return this->tallies.getCount(key);
         return -1;
     }
     auto StatsTracker::getTallyPercentage(const std::string& key) const -> double {
+        if (this->weightedTallies && this->tallies.keyExists(key))
+            return this->tallyWeightTotal > 0 ? (double) (this->tallyWeights.at(key) / this->tallyWeightTotal) : 0;
         if (this->tallies.keyExists(key))
             return this->tallies.getPercentage(key);
         return -1;
@@ -96,6 +128,24 @@ namespace Stats {
             return this->stats.at(key).n;
         return -1;
     }
+    auto StatsTracker::getMeanHalfWidth(const std::string& key, double z) const -> double { // z * standard error of the mean
+        if (this->stats.find(key) == this->stats.end())
+            return std::numeric_limits<double>::max();
+        const auto& sp = this->stats.at(key);
+        if (sp.n < 2) return std::numeric_limits<double>::max(); // no variance estimate yet
+        const double effectiveN = (double) (sp.weightSum * sp.weightSum / sp.weightSquareSum); // kish, n when unweighted
+        return z * std::sqrt((double) sp.sampleVariance / effectiveN);
+    }
+    auto StatsTracker::getTallyHalfWidth(const std::string& key, double z) const -> double {
+        // agresti-coull interval of the tally proportion, doesn't collapse to 0 when a key is never or always tallied
+        if (!this->tallies.keyExists(key))
+            return std::numeric_limits<double>::max();
+        const double total = this->tallies.getTotalCounts();
+        if (total == 0) return 0; // model has no tallies
+        const double adjustedTotal = total + z * z;
+        const double p = (this->tallies.getCount(key) + z * z / 2) / adjustedTotal;
+        return z * std::sqrt(p * (1 - p) / adjustedTotal);
+    }
     template <Concepts::Numeric N>
     auto StatsTracker::addNewValue(const std::string& key, N val) -> bool {
         std::lock_guard m(this->lock);
@@ -103,8 +153,29 @@ namespace Stats {
             return false;
         Internal::StatPack& sp = this->stats.at(key);
         sp.n++;
+        sp.weightSum += 1;
+        sp.weightSquareSum += 1;
         sp.sampleVariance = sampleVarianceStep(sp.n, val, sp.mean, sp.sampleVariance);
         sp.mean = arithmeticMeanStep(sp.n, val, sp.mean);
+        sp.weightedM2 = sp.sampleVariance * (sp.n - 1);
+        return true;
+    }
+    template <Concepts::Numeric N>
+    auto StatsTracker::addWeightedValue(const std::string& key, N val, double weight) -> bool {
+        // west's weighted update. sampleVariance uses reliability weights, so it matches addNewValue when all are 1
+        std::lock_guard m(this->lock);
+        if (this->stats.find(key) == this->stats.end())
+            return false;
+        Internal::StatPack& sp = this->stats.at(key);
+        sp.n++;
+        sp.weightSum += weight;
+        sp.weightSquareSum += (long double) weight * weight;
+        if (sp.weightSum <= 0) return true; // nothing to average yet
+        const long double delta = val - sp.mean;
+        sp.mean += delta * weight / sp.weightSum;
+        sp.weightedM2 += weight * delta * (val - sp.mean);
+        const long double denominator = sp.weightSum - sp.weightSquareSum / sp.weightSum;
+        sp.sampleVariance = denominator > 0 ? sp.weightedM2 / denominator : 0;
         return true;
     }
     auto StatsTracker::addTally(const std::string& key) -> bool {
@@ -112,6 +183,16 @@ namespace Stats {
             this->tallies.tally(key);
         else
             return false;
+        this->tallyWeights[key] += 1;
+        this->tallyWeightTotal += 1;
+        return true;
+    }
+    auto StatsTracker::addTally(const std::string& key, double weight) -> bool { // getTallyPercentage becomes the weighted share
+        if (!this->addTally(key))
+            return false;
+        this->tallyWeights[key] += weight - 1;
+        this->tallyWeightTotal += weight - 1;
+        this->weightedTallies = true;
         return true;
     }
 };
\ No newline at end of file
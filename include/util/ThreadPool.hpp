@@ -1,91 +1,282 @@
+#pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <thread>
-#include <queue>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace ThreadManagement {
+    // work stealing pool. every worker owns a deque: it pushes and pops the tasks it queues itself at the back
+    // (newest first, so nested work stays hot in its cache) and steals the oldest task from the front of another
+    // worker's deque when its own runs dry. tasks queued from outside the pool go through one shared queue, taken
+    // strictly first in first out after a worker's own tasks, so their submission order (e.g. longest first) holds.
+    // with a maxQueued, outside threads block once that many tasks wait to be taken, sleeping until a worker takes
+    // one. tasks queued from inside the pool never block, as the worker they wait on could be the caller itself
     class ThreadPool {
+        struct Worker {
+            std::mutex lock; // held only to push, pop or steal, never while a task runs
+            std::deque<std::function<void()>> tasks;
+        };
+        static constexpr const uint32_t NOT_A_WORKER = UINT32_MAX;
+        inline static thread_local ThreadPool* currentPool = nullptr; // pool and worker index of the calling thread
+        inline static thread_local uint32_t currentWorker = NOT_A_WORKER;
+
         const uint32_t numberOfThreads;
+        const size_t maxQueued; // 0 for unbounded
         bool shouldTerminate;
-        std::mutex queueMutex;
-        std::condition_variable mutexCondition;
+        std::vector<std::unique_ptr<Worker>> workers;
+        Worker submitted; // tasks from outside the pool, pushed at the back, taken from the front
         std::vector<std::thread> threads;
-        std::queue<std::function<void()>> tasks;
+        std::mutex sleepMutex; // only for sleeping on the conditions below
+        std::condition_variable workAvailable;
+        std::condition_variable allFinished;
+        std::condition_variable spaceAvailable;
+        std::atomic<size_t> waitingProducers; // blocked in push, takers only notify when there are any
+        std::atomic<size_t> queued; // pushed, not yet taken by a thread
+        std::atomic<size_t> unfinished; // pushed, not yet finished
 
-        void threadLoop();
+        void threadLoop(uint32_t);
+        void push(std::function<void()>&&);
+        bool take(uint32_t, bool, std::function<void()>&);
+        void taken();
+        void finish();
     public:
-        ThreadPool(const uint32_t);
+        ThreadPool(const uint32_t, const size_t);
         void queueTask(const std::function<void()>&);
-        auto unassignedTasks();
+        template<typename F>
+        auto submit(F&&) -> std::future<std::invoke_result_t<std::decay_t<F>>>;
+        bool runPendingTask();
+        auto unassignedTasks() -> size_t;
         bool busy();
+        void waitIdle();
         ~ThreadPool();
     };
 
-    ThreadPool::ThreadPool(const uint32_t numbOfthreads = std::thread::hardware_concurrency())
+    // tasks run on a pool and awaited together. wait() runs queued tasks on the calling thread while the group is
+    // unfinished (only nested ones when called from a task, see runPendingTask), so tasks can open groups of their
+    // own and wait on them without starving the pool
+    class TaskGroup {
+        ThreadPool& pool;
+        size_t outstanding; // guarded by lock
+        std::mutex lock;
+        std::condition_variable finished;
+        std::exception_ptr error; // first exception thrown by a task, rethrown by wait()
+    public:
+        TaskGroup(ThreadPool&);
+        void run(const std::function<void()>&);
+        void wait();
+        ~TaskGroup();
+    };
+
+    ThreadPool::ThreadPool(const uint32_t numbOfthreads = std::thread::hardware_concurrency(), const size_t maxQueuedTasks = 0)
         : numberOfThreads(numbOfthreads != 0 ? numbOfthreads : 4) // default 4
+        , maxQueued(maxQueuedTasks)
         , shouldTerminate(false)
+        , workers(std::vector<std::unique_ptr<Worker>>())
         , threads(std::vector<std::thread>())
-        , tasks(std::queue<std::function<void()>>())
+        , waitingProducers(0)
+        , queued(0)
+        , unfinished(0)
     {
+        workers.reserve(this->numberOfThreads);
+        for (uint32_t i = 0; i < this->numberOfThreads; i++)
+            workers.push_back(std::make_unique<Worker>());
         threads.reserve(this->numberOfThreads);
         for (uint32_t i = 0; i < this->numberOfThreads; i++) {
             threads.push_back(
                 std::thread(
-                    [this]() { this->threadLoop(); }
+                    [this, i]() { this->threadLoop(i); }
                 )
             );
         }
     }
-    void ThreadPool::threadLoop() {
+    void ThreadPool::threadLoop(uint32_t index) {
+        currentPool = this;
+        currentWorker = index;
         while (true) {
             std::function<void()> task;
-            {
-                std::unique_lock<std::mutex> lock(this->queueMutex);
-                this->mutexCondition.wait(lock, [this] {
-                    return !this->tasks.empty() || this->shouldTerminate;
-                });
-                if (this->shouldTerminate) return;
-                task = this->tasks.front();
-                this->tasks.pop();
+            if (this->take(index, true, task)) {
+                task();
+                this->finish();
+                continue;
             }
-            task();
+            std::unique_lock<std::mutex> lock(this->sleepMutex);
+            this->workAvailable.wait(lock, [this] {
+                return this->queued.load() > 0 || this->shouldTerminate;
+            });
+            if (this->shouldTerminate && this->queued.load() == 0) return;
         }
     }
-    void ThreadPool::queueTask(const std::function<void()>& task) {
+    void ThreadPool::push(std::function<void()>&& task) {
+        if (this->maxQueued != 0 && currentPool != this && this->queued.load() >= this->maxQueued) {
+            // check and push aren't one step, so concurrent outside producers can overshoot by one task each
+            std::unique_lock<std::mutex> lock(this->sleepMutex);
+            this->waitingProducers++;
+            this->spaceAvailable.wait(lock, [this] { return this->queued.load() < this->maxQueued; });
+            this->waitingProducers--;
+        }
+        Worker& target = currentPool == this
+            ? *this->workers[currentWorker] // nested, stays with the worker that made it
+            : this->submitted;
+        this->unfinished++; // before it's visible, so busy() can't miss it
         {
-            std::unique_lock<std::mutex> lock(this->queueMutex);
-            this->tasks.push(task);
+            std::unique_lock<std::mutex> lock(target.lock);
+            target.tasks.push_back(std::move(task));
+            this->queued++; // under the deque's lock, so the count never trails what can be taken
         }
-        this->mutexCondition.notify_one();
-    }
-    auto ThreadPool::unassignedTasks() {
-        std::queue<std::function<void()>>::size_type len;
         {
-            std::unique_lock<std::mutex> lock(this->queueMutex);
-            len = this->tasks.size();
+            std::unique_lock<std::mutex> lock(this->sleepMutex); // a worker between its check and its wait can't miss this
         }
-        return len;
-
+        this->workAvailable.notify_one();
     }
-    bool ThreadPool::busy() {
-        bool poolBusy;
-        {
-            std::unique_lock<std::mutex> lock(this->queueMutex);
-            poolBusy = !this->tasks.empty();
+    bool ThreadPool::take(uint32_t index, bool outsideTasks, std::function<void()>& task) {
+        // own deque from the back, then the outside tasks (if outsideTasks) and the other workers' deques from the
+        // front. index is NOT_A_WORKER for outside threads
+        if (this->queued.load() == 0) return false;
+        if (index != NOT_A_WORKER) {
+            Worker& own = *this->workers[index];
+            std::unique_lock<std::mutex> lock(own.lock);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                lock.unlock();
+                this->taken();
+                return true;
+            }
+        }
+        if (outsideTasks) {
+            std::unique_lock<std::mutex> lock(this->submitted.lock);
+            if (!this->submitted.tasks.empty()) {
+                task = std::move(this->submitted.tasks.front());
+                this->submitted.tasks.pop_front();
+                lock.unlock();
+                this->taken();
+                return true;
+            }
+        }
+        const uint32_t start = index == NOT_A_WORKER ? 0 : index + 1;
+        for (uint32_t k = 0; k < this->numberOfThreads; k++) {
+            Worker& victim = *this->workers[(start + k) % this->numberOfThreads];
+            std::unique_lock<std::mutex> lock(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                lock.unlock();
+                this->taken();
+                return true;
+            }
         }
-        return poolBusy;
+        return false;
+    }
+    void ThreadPool::taken() {
+        this->queued--;
+        if (this->waitingProducers.load() != 0) { // both atomics are seq_cst, a producer about to sleep sees the decrement
+            std::unique_lock<std::mutex> lock(this->sleepMutex);
+            this->spaceAvailable.notify_all();
+        }
+    }
+    void ThreadPool::finish() {
+        if (--this->unfinished == 0) {
+            std::unique_lock<std::mutex> lock(this->sleepMutex);
+            this->allFinished.notify_all();
+        }
+    }
+    void ThreadPool::queueTask(const std::function<void()>& task) {
+        this->push(std::function<void()>(task));
+    }
+    template<typename F>
+    auto ThreadPool::submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        // result or exception of f, through the future. std::function needs a copyable target, so the task is shared
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        auto result = task->get_future();
+        this->push([task]() { (*task)(); });
+        return result;
+    }
+    bool ThreadPool::runPendingTask() {
+        // one queued task on the calling thread, false if there was none. from inside a task only nested tasks are
+        // picked up, never one queued from outside, so a task waiting on its children can't start unrelated top level
+        // work on its stack: helping stays one level deep whatever the outside tasks do
+        std::function<void()> task;
+        const bool inside = currentPool == this;
+        if (!this->take(inside ? currentWorker : NOT_A_WORKER, !inside, task)) return false;
+        task();
+        this->finish();
+        return true;
+    }
+    auto ThreadPool::unassignedTasks() -> size_t {
+        return this->queued.load();
+    }
+    bool ThreadPool::busy() { // queued or still running
+        return this->unfinished.load() != 0;
     }
-    ThreadPool::~ThreadPool() {
+    void ThreadPool::waitIdle() { // sleeps until nothing is queued or running. not from inside a task, it would wait on itself
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->allFinished.wait(lock, [this] { return this->unfinished.load() == 0; });
+    }
+    ThreadPool::~ThreadPool() { // runs everything already queued, then joins
+        this->waitIdle();
         {
-            std::unique_lock<std::mutex> lock(this->queueMutex);
+            std::unique_lock<std::mutex> lock(this->sleepMutex);
             this->shouldTerminate = true;
         }
-        this->mutexCondition.notify_all();
+        this->workAvailable.notify_all();
         for(std::thread& activeThread : this->threads) {
             activeThread.join();
         }
     }
-}
\ No newline at end of file
+
+    TaskGroup::TaskGroup(ThreadPool& taskPool)
+        : pool(taskPool)
+        , outstanding(0)
+    {}
+    void TaskGroup::run(const std::function<void()>& task) {
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->outstanding++;
+        }
+        this->pool.queueTask([this, task]() {
+            std::exception_ptr thrown;
+            try {
+                task();
+            }
+            catch (...) {
+                thrown = std::current_exception();
+            }
+            std::unique_lock<std::mutex> guard(this->lock); // last touch of the group, wait() can't return before it's released
+            if (thrown && !this->error) this->error = thrown;
+            if (--this->outstanding == 0) this->finished.notify_all();
+        });
+    }
+    void TaskGroup::wait() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(this->lock);
+                if (this->outstanding == 0) break;
+            }
+            if (!this->pool.runPendingTask()) { // nothing left to help with, the group's tasks are all running
+                std::unique_lock<std::mutex> guard(this->lock);
+                this->finished.wait(guard, [this] { return this->outstanding == 0; });
+                break;
+            }
+        }
+        std::unique_lock<std::mutex> guard(this->lock);
+        if (this->error) {
+            std::exception_ptr thrown = this->error;
+            this->error = nullptr;
+            std::rethrow_exception(thrown);
+        }
+    }
+    TaskGroup::~TaskGroup() { // tasks hold this, so they all have to be done
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->finished.wait(guard, [this] { return this->outstanding == 0; });
+    }
+}
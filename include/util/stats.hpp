@@ -127,6 +127,7 @@ namespace Stats {
         TallyCounter(TallyCounter&) = default;
         TallyCounter(const TallyCounter&) = default;
         auto add(const std::string&) -> bool;
+        auto reset() -> void;
         auto tally(const std::string&) -> const StorageType&;
         auto getCountsMap() const -> const std::unordered_map<std::string, StorageType>&;
         auto getPercentMap() const -> const std::unordered_map<std::string, double>;
@@ -149,6 +150,12 @@ namespace Stats {
         return true;
     }
     template <Concepts::Numeric StorageType>
+    auto TallyCounter<StorageType>::reset() -> void { // all counts back to 0, keys stay
+        for (auto& [key, count] : this->counts)
+            count = 0;
+        this->totalCounts = 0;
+    }
+    template <Concepts::Numeric StorageType>
     auto TallyCounter<StorageType>::tally(const std::string& key) -> const StorageType& {
         if (this->counts.find(key) != this->counts.end())
             this->counts[key]++;
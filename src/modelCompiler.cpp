@@ -0,0 +1,71 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JsonUtils.hpp"
+#include "FrugallyDeepJson.hpp"
+#include "DenseNetwork.hpp"
+
+// Bakes a frugally-deep model into a header: layer sizes become template arguments and weights constexpr arrays,
+// giving FullSearch a fixed-shape, allocation free forward pass (see FixedDenseNetwork.hpp).
+// usage: ModelCompiler <model.json> <output header>
+
+auto activationName(Inference::Activation a) -> std::string {
+    switch (a) {
+    case Inference::Activation::LINEAR: return "Inference::Activation::LINEAR";
+    case Inference::Activation::RELU: return "Inference::Activation::RELU";
+    case Inference::Activation::SIGMOID: return "Inference::Activation::SIGMOID";
+    case Inference::Activation::TANH: return "Inference::Activation::TANH";
+    case Inference::Activation::SOFTMAX: return "Inference::Activation::SOFTMAX";
+    }
+    return "";
+}
+auto writeArray(std::ofstream& o, const std::string& name, const std::vector<float>& values) -> void {
+    o << "    static constexpr const float " << name << "[" << values.size() << "] = {";
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i != 0) o << ",";
+        o << (i % 8 == 0 ? "\n        " : " ");
+        o << std::hexfloat << values[i] << "f"; // hex floats round trip exactly
+    }
+    o << std::defaultfloat << "\n    };\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <model.json> <output header>" << std::endl;
+        return 1;
+    }
+    const auto j = JsonUtils::readJsonFile(argv[1]);
+    std::string reason = "";
+    auto layers = std::vector<Inference::DenseLayerSpec>();
+    if (!Inference::DenseNetwork::fromJson(j, reason).has_value() // also runs the embedded test cases
+        || !Inference::FrugallyDeepJson::readSequentialDenseModel(j, layers, reason)) { // can't throw once fromJson read it
+        std::cerr << "Model " << argv[1] << " can't be compiled: " << reason << std::endl;
+        return 1;
+    }
+    std::ofstream o(argv[2]);
+    o << "#pragma once\n\n"
+        << "// generated by ModelCompiler from " << argv[1] << ". do not edit\n\n"
+        << "#include \"FixedDenseNetwork.hpp\"\n\n"
+        << "namespace CompiledModel {\n";
+    for (size_t l = 0; l < layers.size(); l++) {
+        const auto& layer = layers[l];
+        const auto prefix = "LAYER_" + std::to_string(l);
+        o << "    // " << layer.name << ": " << layer.inputs << " -> " << layer.units << "\n";
+        writeArray(o, prefix + "_WEIGHTS", layer.weights);
+        writeArray(o, prefix + "_BIAS", layer.bias);
+        o << "    using Layer" << l << " = Inference::FixedDenseLayer<" << layer.inputs << ", " << layer.units << ", "
+            << activationName(layer.activation) << ", " << prefix << "_WEIGHTS, " << prefix << "_BIAS>;\n\n";
+    }
+    o << "    using Network = Inference::FixedDenseNetwork<";
+    for (size_t l = 0; l < layers.size(); l++)
+        o << "Layer" << l << (l + 1 < layers.size() ? ", " : "");
+    o << ">;\n"
+        << "    constexpr const uint32_t INPUT_SIZE = Network::INPUT_SIZE;\n"
+        << "    constexpr const uint32_t OUTPUT_SIZE = Network::OUTPUT_SIZE;\n"
+        << "}\n";
+    o.close();
+    std::cout << "Compiled " << layers.size() << " layers of " << argv[1] << " into " << argv[2] << std::endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+// checks that a grid point allocates nothing once its task's buffers exist. FullSearch::iterate, the function every
+// search task runs per point, is driven on a DenseNetwork and counted through a replaced global operator new. the
+// json row a point is written out as is left out, it allocates by design.
+// usage: allocationTest <saved model json> <features json>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace {
+    std::atomic<size_t> allocations = 0;
+    std::atomic<bool> counting = false;
+}
+void* operator new(size_t size) {
+    if (counting.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size != 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fullSearchPoint.hpp"
+#include "ModelFeatureJsonUtils.hpp"
+#include "EmpiricalDistribution.hpp"
+
+constexpr const int WARMUP_POINTS = 3; // first points may still grow buffers to their working size
+constexpr const int POINTS = 12;
+
+// runs POINTS grid points the way a search task does, returns how many after the warm up allocated
+auto check(const std::string& name, TrialManager& set, const Inference::DenseNetwork& network) -> int {
+    auto gen = Random::Generator(7);
+    set.setRandomGen(&gen);
+    set.setCommonRandomNumbers(FullSearch::COMMON_RANDOM_NUMBERS);
+    auto buffers = FullSearch::SampleBuffers(network, set);
+    FullSearch::drawCommonSamples(network, set, gen, buffers);
+    auto point = std::pair<std::vector<double>, Stats::StatsTracker>(
+        std::vector<double>(),
+        Stats::StatsTracker(FullSearch::STATS_KEYS)
+    );
+    int failures = 0;
+    for (int p = 0; p < POINTS; p++) {
+        const size_t before = allocations.load();
+        counting = true;
+        gen.seek(p);
+        FullSearch::iterate(network, set, point, buffers);
+        counting = false;
+        const size_t made = allocations.load() - before;
+        if (p >= WARMUP_POINTS && made != 0) {
+            std::cout << name << ": point " << p << " made " << made << " allocations" << std::endl;
+            failures++;
+        }
+    }
+    if (failures == 0)
+        std::cout << name << ": ok" << std::endl;
+    return failures;
+}
+
+// dense softmax layer over inputs, in the frugally-deep json layout, for sets the saved model doesn't fit
+auto denseModel(uint32_t inputs, uint32_t outputs) -> Inference::DenseNetwork {
+    auto weights = json::array();
+    for (uint32_t i = 0; i < inputs * outputs; i++)
+        weights.push_back(0.1 * ((i * 7) % 11) - 0.5);
+    auto bias = json::array();
+    for (uint32_t o = 0; o < outputs; o++)
+        bias.push_back(0.1 * o);
+    json inputLayer = {{"class_name", "InputLayer"}, {"name", "input"}};
+    inputLayer["config"] = {{"name", "input"}, {"batch_input_shape", json::array({nullptr, inputs})}};
+    json denseLayer = {{"class_name", "Dense"}, {"name", "dense"}};
+    denseLayer["config"] = {{"name", "dense"}, {"units", outputs}, {"activation", "softmax"}};
+    json j = JsonUtils::JsonObject;
+    j["architecture"]["config"]["layers"] = json::array({inputLayer, denseLayer});
+    j["trainable_params"]["dense"]["weights"] = weights;
+    j["trainable_params"]["dense"]["bias"] = bias;
+    std::string reason = "";
+    return Inference::DenseNetwork::fromJson(j, reason).value();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "usage: allocationTest <saved model json> <features json>" << std::endl;
+        return 2;
+    }
+    const auto network = Inference::DenseNetwork::load(argv[1]);
+    if (!network.has_value()) {
+        std::cout << "could not load " << argv[1] << std::endl;
+        return 2;
+    }
+    FullSearch::STATS_KEYS = FullSearch::statsKeys();
+    const auto input = ModelFeatureJsonUtils::readInputFile(std::string(argv[2]));
+    const auto features = ModelFeatureJsonUtils::getFeaturesFromInput(input);
+    const auto featuresAndDomains = ModelFeatureJsonUtils::getFeaturesAndDomainsFromInput(input);
+    const auto constrainedFeatures = ModelFeatureJsonUtils::getConstraintedFeaturesFromInput(input);
+    const auto histogram = std::make_shared<const Random::EmpiricalDistribution>(std::vector<double>{1, 4, 2, 0, 3});
+    int failures = 0;
+
+    const char* modes[] = {"monte carlo", "quasi monte carlo", "stratified", "latin hypercube"};
+    for (int mode = MONTE_CARLO; mode <= LATIN_HYPERCUBE; mode++) { // the model's own features, continuous only
+        auto set = TrialManager({features[0], features[2]}, features, featuresAndDomains, constrainedFeatures);
+        set.setContinuousN(3);
+        set.setSamplingMode((SAMPLING_MODE) mode);
+        set.setDistributions({{features[1], histogram}});
+        failures += check(std::string("model, ") + modes[mode], set, network.value());
+    }
+
+    // discrete, histogram and one hot features
+    const auto mixed = std::vector<std::string>{"x", "k", "y", "z", "c", "d"};
+    const auto mixedDomains = std::unordered_map<std::string, DomainVariantType>{
+        {"x", Domain<double>(0, 1)},
+        {"k", Domain<int64_t>(0, 2)},
+        {"y", Domain<double>(-1, 1)},
+        {"z", Domain<int64_t>(0, 4)},
+        {"c", Domain<int64_t>(0, 1)},
+        {"d", Domain<int64_t>(0, 1)}
+    };
+    const auto oneHot = std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>{
+        {ONLYONEHIGHBINARY, {{"c", "d"}}}
+    };
+    const auto mixedNetwork = denseModel(mixed.size(), 3);
+    for (int mode = MONTE_CARLO; mode <= LATIN_HYPERCUBE; mode++) {
+        auto set = TrialManager({"x", "k"}, mixed, mixedDomains, oneHot);
+        set.setContinuousN(3);
+        set.setSamplingMode((SAMPLING_MODE) mode);
+        set.setDistributions({{"y", histogram}, {"z", histogram}});
+        failures += check(std::string("mixed, ") + modes[mode], set, mixedNetwork);
+    }
+    if constexpr (!FullSearch::COMMON_RANDOM_NUMBERS) {
+        auto set = TrialManager({"x", "y"}, mixed, mixedDomains, oneHot); // only discrete randoms, enumerated
+        set.setContinuousN(3);
+        set.setEnumeration(true);
+        failures += check("mixed, enumerated", set, mixedNetwork);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+// checks that a grid point's samples depend only on its grid index. a point reached with seekGrid, the way a chunk or a
+// refinement task starts, has to draw the same sample matrix as the same point reached by walking the grid from 0.
+// counting features also have to take the same values both ways.
+// usage: reproducibilityTest
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TrialManager.hpp"
+
+constexpr const uint64_t SAMPLES = 64; // several strata cycles of the discrete features per point
+constexpr const uint64_t POINTS = 6;
+
+const auto FEATURES = std::vector<std::string>{"x", "k", "y", "z", "c", "d"};
+const auto DOMAINS = std::unordered_map<std::string, DomainVariantType>{
+    {"x", Domain<double>(0, 1)},
+    {"k", Domain<int64_t>(0, 2)},
+    {"y", Domain<double>(-1, 1)},
+    {"z", Domain<int64_t>(0, 4)},
+    {"c", Domain<int64_t>(0, 1)},
+    {"d", Domain<int64_t>(0, 1)}
+};
+const auto ONE_HOT = std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>{
+    {ONLYONEHIGHBINARY, {{"c", "d"}}}
+};
+
+// sample matrix and one-hot choices of the set's current grid point, drawn the way a search task does
+auto drawPoint(TrialManager& set, Random::Generator& gen) -> std::vector<float> {
+    const size_t width = set.getFeatureCount();
+    const size_t groups = set.getOneHotColumns().size();
+    gen.seek(set.getGridIndex());
+    const uint64_t samples = set.beginPoint(SAMPLES);
+    auto inputs = std::vector<float>(samples * width);
+    auto active = std::vector<uint32_t>(samples * groups);
+    set.generateSamples(inputs.data(), samples, active.data());
+    for (const auto& a : active)
+        inputs.push_back((float) a);
+    return inputs;
+}
+
+auto check(const std::string& name, SAMPLING_MODE mode) -> int {
+    auto walked = std::vector<std::vector<float>>();
+    {
+        auto set = TrialManager({"x", "k"}, FEATURES, DOMAINS, ONE_HOT);
+        auto gen = Random::Generator(7);
+        set.setRandomGen(&gen);
+        set.setContinuousN(3);
+        set.setSamplingMode(mode);
+        for (uint64_t p = 0; p < POINTS; p++) {
+            walked.push_back(drawPoint(set, gen));
+            set.iterateCountingFeatures();
+        }
+    }
+    int failures = 0;
+    for (uint64_t p = 0; p < POINTS; p++) {
+        auto set = TrialManager({"x", "k"}, FEATURES, DOMAINS, ONE_HOT);
+        auto gen = Random::Generator(7);
+        set.setRandomGen(&gen);
+        set.setContinuousN(3);
+        set.setSamplingMode(mode);
+        set.seekGrid(p);
+        if (drawPoint(set, gen) != walked[p]) {
+            std::cout << name << ": point " << p << " differs when seeked to" << std::endl;
+            failures++;
+        }
+    }
+    if (failures == 0)
+        std::cout << name << ": ok" << std::endl;
+    return failures;
+}
+
+// one-hot sets whose members are all counting features have exactly one of them high at every grid point, also after
+// the walk wraps the first set around, and walking matches seeking. the point's samples carry the same columns
+auto checkCountingOneHot() -> int {
+    const auto features = std::vector<std::string>{"x", "c", "d", "e", "f"};
+    auto domains = DOMAINS;
+    domains.insert({"e", Domain<int64_t>(0, 1)});
+    domains.insert({"f", Domain<int64_t>(0, 1)});
+    const auto oneHot = std::unordered_map<CONSTRAINT_TYPE, std::vector<std::vector<std::string>>>{
+        {ONLYONEHIGHBINARY, {{"c", "d"}, {"e", "f"}}}
+    };
+    auto walked = TrialManager({"c", "d", "e", "f"}, features, domains, oneHot);
+    auto seeked = TrialManager({"c", "d", "e", "f"}, features, domains, oneHot);
+    auto gen = Random::Generator(7);
+    walked.setRandomGen(&gen);
+    float current[4];
+    float expected[4];
+    float samples[4 * 5];
+    uint32_t active[4 * 2];
+    uint64_t points = 0;
+    int failures = 0;
+    do {
+        if (points == seeked.gridSize()) { // the walk has more points than the grid
+            failures++;
+            std::cout << "counting one hot: walked past " << points << " points" << std::endl;
+            break;
+        }
+        walked.getCountingCurrent(current);
+        seeked.seekGrid(points);
+        seeked.getCountingCurrent(expected);
+        if (current[0] + current[1] != 1.0f || current[2] + current[3] != 1.0f || !std::equal(current, current + 4, expected)) {
+            std::cout << "counting one hot: point " << points << " is c=" << current[0] << " d=" << current[1]
+                << " e=" << current[2] << " f=" << current[3] << std::endl;
+            failures++;
+        }
+        walked.beginPoint(4);
+        walked.generateSamples(samples, 4, active);
+        for (size_t r = 0; r < 4; r++)
+            if (!std::equal(current, current + 4, samples + r * 5 + 1)
+                || samples[r * 5 + active[r * 2]] != 1.0f || samples[r * 5 + active[r * 2 + 1]] != 1.0f) {
+                std::cout << "counting one hot: sample " << r << " of point " << points << " has other columns" << std::endl;
+                failures++;
+            }
+        points++;
+    } while (!walked.iterateCountingFeatures());
+    if (points < walked.gridSize()) {
+        std::cout << "counting one hot: walked " << points << " of " << walked.gridSize() << " points" << std::endl;
+        failures++;
+    }
+    if (failures == 0)
+        std::cout << "counting one hot: ok" << std::endl;
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    failures += checkCountingOneHot();
+    failures += check("monte carlo", MONTE_CARLO);
+    failures += check("quasi monte carlo", QUASI_MONTE_CARLO);
+    failures += check("stratified", STRATIFIED);
+    failures += check("latin hypercube", LATIN_HYPERCUBE);
+    return failures == 0 ? 0 : 1;
+}